@@ -954,7 +954,8 @@ i915_composite(PixmapPtr dest, int srcX, int srcY, int maskX, int maskY,
 
 			OUT_BATCH(_3DSTATE_LOAD_STATE_IMMEDIATE_1 |
 				  I1_LOAD_S(0) | I1_LOAD_S(1) | 1);
-			OUT_RELOC(intel->vertex_bo, I915_GEM_DOMAIN_VERTEX, 0, 0);
+			OUT_RELOC(intel->vertex_bo, I915_GEM_DOMAIN_VERTEX, 0,
+				  intel->vertex_base);
 			OUT_BATCH((intel->floats_per_vertex << S1_VERTEX_WIDTH_SHIFT) |
 				  (intel->floats_per_vertex << S1_VERTEX_PITCH_SHIFT));
 			intel->vertex_index = 0;
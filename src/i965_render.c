@@ -761,6 +761,27 @@ struct gen4_render_state {
 	    [FILTER_COUNT]
 	    [EXTEND_COUNT];
 	gen4_composite_op composite_op;
+
+	/* Surface states already written into the current surface bo */
+	struct gen4_surface_cache {
+		drm_intel_bo *bo;
+		uint32_t format;
+		uint16_t width, height;
+		uint32_t pitch;
+		Bool tiled;
+		Bool is_dst;
+		int offset;
+	} surface_cache[8];
+	int surface_cache_next;
+	int binding_table[3];
+
+	/* The last rectangle emitted, so that it may be extended */
+	struct gen4_composite_rect {
+		int x, y, w, h;
+		int src_dx, src_dy;
+		int mask_dx, mask_dy;
+		int used;
+	} last_rect;
 };
 
 static void gen6_emit_composite_state(struct intel_screen_private *intel);
@@ -1412,14 +1433,68 @@ gen7_set_picture_surface_state(intel_screen_private *intel,
 	return offset;
 }
 
-static inline int
+static void i965_surface_cache_reset(struct gen4_render_state *render)
+{
+	memset(render->surface_cache, 0, sizeof(render->surface_cache));
+	render->surface_cache_next = 0;
+	render->binding_table[0] = -1;
+}
+
+/* The same few pictures tend to be used over and over again, so look
+ * for a copy of the surface state already written into this surface bo
+ * before encoding another.
+ */
+static int
 i965_set_picture_surface_state(intel_screen_private *intel,
 			       PicturePtr picture, PixmapPtr pixmap,
 			       Bool is_dst)
 {
-    if (INTEL_INFO(intel)->gen < 70)
-        return gen4_set_picture_surface_state(intel, picture, pixmap, is_dst);
-    return gen7_set_picture_surface_state(intel, picture, pixmap, is_dst);
+	struct gen4_render_state *render = intel->gen4_render_state;
+	struct intel_pixmap *priv = intel_get_pixmap_private(pixmap);
+	struct gen4_surface_cache *c;
+	uint32_t format;
+	int i;
+
+	if (is_dst)
+		format = i965_get_dest_format(picture);
+	else
+		format = i965_get_card_format(picture);
+
+	for (i = 0; i < ARRAY_SIZE(render->surface_cache); i++) {
+		c = &render->surface_cache[i];
+		if (c->bo == priv->bo &&
+		    c->format == format &&
+		    c->is_dst == is_dst &&
+		    c->width == pixmap->drawable.width &&
+		    c->height == pixmap->drawable.height &&
+		    c->pitch == intel_pixmap_pitch(pixmap) &&
+		    c->tiled == intel_pixmap_tiled(pixmap)) {
+			if (is_dst)
+				intel_batch_mark_pixmap_domains(intel, priv,
+								I915_GEM_DOMAIN_RENDER,
+								I915_GEM_DOMAIN_RENDER);
+			else
+				intel_batch_mark_pixmap_domains(intel, priv,
+								I915_GEM_DOMAIN_SAMPLER,
+								0);
+			return c->offset;
+		}
+	}
+
+	c = &render->surface_cache[render->surface_cache_next++ % ARRAY_SIZE(render->surface_cache)];
+	c->bo = priv->bo;
+	c->format = format;
+	c->is_dst = is_dst;
+	c->width = pixmap->drawable.width;
+	c->height = pixmap->drawable.height;
+	c->pitch = intel_pixmap_pitch(pixmap);
+	c->tiled = intel_pixmap_tiled(pixmap);
+
+	if (INTEL_INFO(intel)->gen < 70)
+		c->offset = gen4_set_picture_surface_state(intel, picture, pixmap, is_dst);
+	else
+		c->offset = gen7_set_picture_surface_state(intel, picture, pixmap, is_dst);
+	return c->offset;
 }
 
 static void gen4_composite_vertex_elements(struct intel_screen_private *intel)
@@ -1768,6 +1843,7 @@ static void i965_surface_flush(struct intel_screen_private *intel)
 				   intel->surface_data);
 	assert(ret == 0);
 	intel->surface_used = 0;
+	i965_surface_cache_reset(intel->gen4_render_state);
 
 	assert (intel->surface_reloc != 0);
 	drm_intel_bo_emit_reloc(intel->batch_bo,
@@ -2025,6 +2101,8 @@ i965_prepare_composite(int op, PicturePtr source_picture,
 	struct gen4_render_state *render_state = intel->gen4_render_state;
 	gen4_composite_op *composite_op = &render_state->composite_op;
 
+	render_state->last_rect.used = -1;
+
 	composite_op->src_filter =
 	    sampler_state_filter_from_picture(source_picture->filter);
 	if (composite_op->src_filter == SS_INVALID_FILTER) {
@@ -2200,11 +2278,12 @@ static void i965_select_vertex_buffer(struct intel_screen_private *intel)
 			  VB0_VERTEXDATA |
 			  (4*intel->floats_per_vertex << VB0_BUFFER_PITCH_SHIFT));
 	}
-	OUT_RELOC(intel->vertex_bo, I915_GEM_DOMAIN_VERTEX, 0, 0);
+	OUT_RELOC(intel->vertex_bo, I915_GEM_DOMAIN_VERTEX, 0,
+		  intel->vertex_base);
 	if (INTEL_INFO(intel)->gen >= 50)
 		OUT_RELOC(intel->vertex_bo,
 			  I915_GEM_DOMAIN_VERTEX, 0,
-			  sizeof(intel->vertex_ptr) - 1);
+			  intel->vertex_base + sizeof(intel->vertex_ptr) - 1);
 	else
 		OUT_BATCH(0);
 	OUT_BATCH(0);		// ignore for VERTEXDATA, but still there
@@ -2214,31 +2293,87 @@ static void i965_select_vertex_buffer(struct intel_screen_private *intel)
 
 static void i965_bind_surfaces(struct intel_screen_private *intel)
 {
+	struct gen4_render_state *render = intel->gen4_render_state;
 	uint32_t *binding_table;
+	int surface[3];
 
 	assert(intel->surface_used + 4 * SURFACE_STATE_PADDED_SIZE <= sizeof(intel->surface_data));
 
-	binding_table = (uint32_t*) (intel->surface_data + intel->surface_used);
-	intel->surface_table = intel->surface_used;
-	intel->surface_used += SURFACE_STATE_PADDED_SIZE;
-
-	binding_table[0] =
+	surface[0] =
 		i965_set_picture_surface_state(intel,
 					       intel->render_dest_picture,
 					       intel->render_dest,
 					       TRUE);
-	binding_table[1] =
+	surface[1] =
 		i965_set_picture_surface_state(intel,
 					       intel->render_source_picture,
 					       intel->render_source,
 					       FALSE);
+	surface[2] = 0;
 	if (intel->render_mask) {
-		binding_table[2] =
+		surface[2] =
 			i965_set_picture_surface_state(intel,
 						       intel->render_mask_picture,
 						       intel->render_mask,
 						       FALSE);
 	}
+
+	/* Reuse the previous binding table if nothing has changed */
+	if (memcmp(surface, render->binding_table, sizeof(surface)) == 0)
+		return;
+
+	binding_table = (uint32_t*) (intel->surface_data + intel->surface_used);
+	intel->surface_table = intel->surface_used;
+	intel->surface_used += SURFACE_STATE_PADDED_SIZE;
+
+	binding_table[0] = surface[0];
+	binding_table[1] = surface[1];
+	if (intel->render_mask)
+		binding_table[2] = surface[2];
+
+	memcpy(render->binding_table, surface, sizeof(surface));
+}
+
+/* Boxes are frequently composited in sequence along a row or down a
+ * column with the same source and mask offsets. Rather than emit
+ * another three vertices, grow the previous rectangle to cover both.
+ */
+static Bool
+i965_composite_extend(intel_screen_private *intel,
+		      int srcX, int srcY,
+		      int maskX, int maskY,
+		      int dstX, int dstY,
+		      int w, int h)
+{
+	struct gen4_composite_rect *last = &intel->gen4_render_state->last_rect;
+
+	if (last->used < 0 || intel->vertex_offset == 0 ||
+	    intel->vertex_used != last->used + 3*intel->floats_per_vertex)
+		return FALSE;
+
+	if (srcX - dstX != last->src_dx || srcY - dstY != last->src_dy)
+		return FALSE;
+
+	if (intel->prim_emit == i965_emit_composite_primitive_identity_source_mask) {
+		if (maskX - dstX != last->mask_dx || maskY - dstY != last->mask_dy)
+			return FALSE;
+	} else if (intel->prim_emit != i965_emit_composite_primitive_identity_source)
+		return FALSE;
+
+	if (dstY == last->y && h == last->h && dstX == last->x + last->w) {
+		last->w += w;
+	} else if (dstX == last->x && w == last->w && dstY == last->y + last->h) {
+		last->h += h;
+	} else
+		return FALSE;
+
+	intel->vertex_used = last->used;
+	intel->prim_emit(intel,
+			 last->x + last->src_dx, last->y + last->src_dy,
+			 last->x + last->mask_dx, last->y + last->mask_dy,
+			 last->x, last->y,
+			 last->w, last->h);
+	return TRUE;
 }
 
 void
@@ -2247,8 +2382,19 @@ i965_composite(PixmapPtr dest, int srcX, int srcY, int maskX, int maskY,
 {
 	ScrnInfoPtr scrn = xf86ScreenToScrn(dest->drawable.pScreen);
 	intel_screen_private *intel = intel_get_screen_private(scrn);
+	struct gen4_composite_rect *last = &intel->gen4_render_state->last_rect;
 
 	intel_batch_start_atomic(scrn, 200);
+	if (!intel->needs_render_state_emit &&
+	    i965_composite_extend(intel,
+				  srcX, srcY,
+				  maskX, maskY,
+				  dstX, dstY,
+				  w, h)) {
+		intel_batch_end_atomic(scrn);
+		return;
+	}
+
 	if (intel->needs_render_state_emit) {
 		i965_bind_surfaces(intel);
 
@@ -2291,6 +2437,16 @@ i965_composite(PixmapPtr dest, int srcX, int srcY, int maskX, int maskY,
 		intel->vertex_count = intel->vertex_index;
 	}
 
+	last->used = intel->vertex_used;
+	last->x = dstX;
+	last->y = dstY;
+	last->w = w;
+	last->h = h;
+	last->src_dx = srcX - dstX;
+	last->src_dy = srcY - dstY;
+	last->mask_dx = maskX - dstX;
+	last->mask_dy = maskY - dstY;
+
 	intel->prim_emit(intel,
 			 srcX, srcY,
 			 maskX, maskY,
@@ -2315,6 +2471,7 @@ void i965_batch_commit_notify(intel_screen_private *intel)
 	intel->vertex_index = 0;
 
 	intel->gen4_render_state->composite_op.vertex_id = -1;
+	intel->gen4_render_state->last_rect.used = -1;
 
 	intel->gen6_render_state.num_sf_outputs = 0;
 	intel->gen6_render_state.samplers = NULL;
@@ -2354,6 +2511,7 @@ void gen4_render_state_init(ScrnInfoPtr scrn)
 		intel->gen4_render_state = calloc(1, sizeof(*render));
 		assert(intel->gen4_render_state != NULL);
 	}
+	i965_surface_cache_reset(intel->gen4_render_state);
 
 	if (INTEL_INFO(intel)->gen >= 60)
 		return gen6_render_state_init(scrn);
@@ -2953,6 +3111,8 @@ void i965_vertex_flush(struct intel_screen_private *intel)
 			intel->vertex_index - intel->vertex_count;
 		intel->vertex_offset = 0;
 	}
+
+	intel->gen4_render_state->last_rect.used = -1;
 }
 
 void i965_batch_flush(struct intel_screen_private *intel)
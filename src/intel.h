@@ -190,6 +190,8 @@ typedef struct intel_screen_private {
 	struct list batch_pixmaps;
 	drm_intel_bo *wa_scratch_bo;
 	OsTimerPtr cache_expire;
+	OsTimerPtr flush_timer;
+	Bool flush_armed;
 
 	/* For Xvideo */
 	Bool use_overlay;
@@ -308,6 +310,8 @@ typedef struct intel_screen_private {
 	uint32_t vertex_id;
 	float vertex_ptr[4*1024];
 	dri_bo *vertex_bo;
+	dri_bo *last_vertex_bo;
+	uint32_t vertex_base;
 
 	uint8_t surface_data[16*1024];
 	uint16_t surface_used;
@@ -315,6 +319,16 @@ typedef struct intel_screen_private {
 	uint32_t surface_reloc;
 	dri_bo *surface_bo;
 
+	/* Linear staging buffers for PutImage into busy pixmaps: each is
+	 * filled only whilst it is referenced by the current batch and
+	 * the pool moves on to the next upon submission.
+	 */
+	struct intel_upload {
+		dri_bo *bo[4];
+		int current;
+		uint32_t used;
+	} upload;
+
 	/* 965 render acceleration state */
 	struct gen4_render_state *gen4_render_state;
 
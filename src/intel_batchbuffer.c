@@ -44,16 +44,27 @@
 
 #define DUMP_BATCHBUFFERS NULL // "/tmp/i915-batchbuffers.dump"
 
+/* Vertices are written into windows of sizeof(vertex_ptr) carved out
+ * of a larger bo, so that a batch can run through several windows
+ * before needing another bo, and an idle bo can be refilled in the
+ * next batch rather than allocating another.
+ */
+#define VERTEX_BO_SIZE (256*1024)
+
 static void intel_end_vertex(intel_screen_private *intel)
 {
 	if (intel->vertex_bo) {
 		if (intel->vertex_used) {
-			dri_bo_subdata(intel->vertex_bo, 0, intel->vertex_used*4, intel->vertex_ptr);
+			dri_bo_subdata(intel->vertex_bo, intel->vertex_base,
+				       intel->vertex_used*4, intel->vertex_ptr);
+			intel->vertex_base += ALIGN(intel->vertex_used*4, 64);
 			intel->vertex_used = 0;
 		}
 
-		dri_bo_unreference(intel->vertex_bo);
-		intel->vertex_bo = NULL;
+		if (intel->vertex_base + sizeof(intel->vertex_ptr) > intel->vertex_bo->size) {
+			dri_bo_unreference(intel->vertex_bo);
+			intel->vertex_bo = NULL;
+		}
 	}
 
 	intel->vertex_id = 0;
@@ -63,8 +74,49 @@ void intel_next_vertex(intel_screen_private *intel)
 {
 	intel_end_vertex(intel);
 
-	intel->vertex_bo =
-		dri_bo_alloc(intel->bufmgr, "vertex", sizeof (intel->vertex_ptr), 4096);
+	if (intel->vertex_bo == NULL) {
+		dri_bo *bo = intel->last_vertex_bo;
+
+		/* Refill the bo used by the previous batch if the GPU
+		 * has finished with it, otherwise leave it for libdrm
+		 * to recycle once it is retired.
+		 */
+		intel->last_vertex_bo = NULL;
+		if (bo && drm_intel_bo_busy(bo)) {
+			dri_bo_unreference(bo);
+			bo = NULL;
+		}
+		if (bo == NULL)
+			bo = dri_bo_alloc(intel->bufmgr, "vertex",
+					  VERTEX_BO_SIZE, 4096);
+
+		intel->vertex_bo = bo;
+		intel->vertex_base = 0;
+	}
+}
+
+static void intel_retire_vertex(intel_screen_private *intel)
+{
+	if (intel->vertex_bo == NULL)
+		return;
+
+	if (intel->last_vertex_bo)
+		dri_bo_unreference(intel->last_vertex_bo);
+	intel->last_vertex_bo = intel->vertex_bo;
+	intel->vertex_bo = NULL;
+}
+
+static void intel_end_upload(intel_screen_private *intel)
+{
+	struct intel_upload *upload = &intel->upload;
+
+	/* The staging buffer is now in flight; writing into it again would
+	 * stall, so the next upload starts afresh in the next one.
+	 */
+	if (upload->used) {
+		upload->current = (upload->current + 1) % ARRAY_SIZE(upload->bo);
+		upload->used = 0;
+	}
 }
 
 static void intel_next_batch(ScrnInfoPtr scrn)
@@ -101,6 +153,7 @@ void intel_batch_init(ScrnInfoPtr scrn)
 void intel_batch_teardown(ScrnInfoPtr scrn)
 {
 	intel_screen_private *intel = intel_get_screen_private(scrn);
+	unsigned int i;
 
 	if (intel->batch_bo != NULL) {
 		dri_bo_unreference(intel->batch_bo);
@@ -112,6 +165,19 @@ void intel_batch_teardown(ScrnInfoPtr scrn)
 		intel->vertex_bo = NULL;
 	}
 
+	if (intel->last_vertex_bo) {
+		dri_bo_unreference(intel->last_vertex_bo);
+		intel->last_vertex_bo = NULL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(intel->upload.bo); i++) {
+		if (intel->upload.bo[i]) {
+			dri_bo_unreference(intel->upload.bo[i]);
+			intel->upload.bo[i] = NULL;
+		}
+	}
+	intel->upload.used = 0;
+
 	while (!list_is_empty(&intel->batch_pixmaps))
 		list_del(intel->batch_pixmaps.next);
 }
@@ -207,6 +273,8 @@ void intel_batch_submit(ScrnInfoPtr scrn)
 	if (intel->vertex_flush)
 		intel->vertex_flush(intel);
 	intel_end_vertex(intel);
+	intel_retire_vertex(intel);
+	intel_end_upload(intel);
 
 	if (intel->batch_flush)
 		intel->batch_flush(intel);
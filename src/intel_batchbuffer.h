@@ -45,7 +45,7 @@ static inline int intel_batch_space(intel_screen_private *intel)
 
 static inline int intel_vertex_space(intel_screen_private *intel)
 {
-	return intel->vertex_bo ? intel->vertex_bo->size - (4*intel->vertex_used) : 0;
+	return intel->vertex_bo ? sizeof(intel->vertex_ptr) - (4*intel->vertex_used) : 0;
 }
 
 static inline void
@@ -1148,6 +1148,10 @@ static Bool I830CloseScreen(CLOSE_SCREEN_ARGS_DECL)
 	TimerFree(intel->cache_expire);
 	intel->cache_expire = NULL;
 
+	TimerFree(intel->flush_timer);
+	intel->flush_timer = NULL;
+	intel->flush_armed = FALSE;
+
 	if (intel->uxa_driver) {
 		uxa_driver_fini(screen);
 		free(intel->uxa_driver);
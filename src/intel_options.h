@@ -23,6 +23,7 @@ enum intel_options {
 	OPTION_PREFER_OVERLAY,
 	OPTION_HOTPLUG,
 	OPTION_RELAXED_FENCING,
+	OPTION_TRIPLE_BUFFER,
 #if defined(XvMCExtension) && defined(ENABLE_XVMC)
 	OPTION_XVMC,
 #define INTEL_XVMC 1
@@ -33,6 +34,11 @@ enum intel_options {
 	OPTION_DELAYED_FLUSH,
 	OPTION_TEAR_FREE,
 	OPTION_CRTC_PIXMAPS,
+	OPTION_XV_FRAMES,
+	OPTION_DEBUG_STATS,
+	OPTION_MIGRATION_POLICY,
+	OPTION_MIGRATION_TRACE,
+	OPTION_DEBUG_PROFILE,
 #endif
 #ifdef USE_UXA
 	OPTION_FALLBACKDEBUG,
@@ -40,7 +46,6 @@ enum intel_options {
 	OPTION_DEBUG_FLUSH_CACHES,
 	OPTION_DEBUG_WAIT,
 	OPTION_BUFFER_CACHE,
-	OPTION_TRIPLE_BUFFER,
 #endif
 	NUM_OPTIONS,
 };
@@ -301,54 +301,100 @@ intel_uxa_prepare_solid(PixmapPtr pixmap, int alu, Pixel planemask, Pixel fg)
 	return TRUE;
 }
 
-static void intel_uxa_solid(PixmapPtr pixmap, int x1, int y1, int x2, int y2)
+static inline Bool
+intel_uxa_clip_box(PixmapPtr pixmap, const BoxRec *box, BoxRec *clip)
+{
+	*clip = *box;
+
+	if (clip->x1 < 0)
+		clip->x1 = 0;
+	if (clip->y1 < 0)
+		clip->y1 = 0;
+	if (clip->x2 > pixmap->drawable.width)
+		clip->x2 = pixmap->drawable.width;
+	if (clip->y2 > pixmap->drawable.height)
+		clip->y2 = pixmap->drawable.height;
+
+	return clip->x2 > clip->x1 && clip->y2 > clip->y1;
+}
+
+static void
+intel_uxa_solid_boxes(PixmapPtr pixmap, const BoxRec *box, int nbox)
 {
 	ScrnInfoPtr scrn = xf86ScreenToScrn(pixmap->drawable.pScreen);
 	intel_screen_private *intel = intel_get_screen_private(scrn);
 	unsigned long pitch;
 	uint32_t cmd;
 
-	if (x1 < 0)
-		x1 = 0;
-	if (y1 < 0)
-		y1 = 0;
-	if (x2 > pixmap->drawable.width)
-		x2 = pixmap->drawable.width;
-	if (y2 > pixmap->drawable.height)
-		y2 = pixmap->drawable.height;
-
-	if (x2 <= x1 || y2 <= y1)
-		return;
-
 	pitch = intel_pixmap_pitch(pixmap);
 
-	{
-		BEGIN_BATCH_BLT(6);
+	cmd = XY_COLOR_BLT_CMD;
 
-		cmd = XY_COLOR_BLT_CMD;
+	if (pixmap->drawable.bitsPerPixel == 32)
+		cmd |= XY_COLOR_BLT_WRITE_ALPHA | XY_COLOR_BLT_WRITE_RGB;
 
-		if (pixmap->drawable.bitsPerPixel == 32)
-			cmd |=
-			    XY_COLOR_BLT_WRITE_ALPHA | XY_COLOR_BLT_WRITE_RGB;
+	if (INTEL_INFO(intel)->gen >= 40 && intel_pixmap_tiled(pixmap)) {
+		assert((pitch % 512) == 0);
+		pitch >>= 2;
+		cmd |= XY_COLOR_BLT_TILED;
+	}
 
-		if (INTEL_INFO(intel)->gen >= 40 && intel_pixmap_tiled(pixmap)) {
-			assert((pitch % 512) == 0);
-			pitch >>= 2;
-			cmd |= XY_COLOR_BLT_TILED;
-		}
+	while (nbox) {
+		BoxRec clip;
+		int n, i, count;
 
-		OUT_BATCH(cmd);
+		/* Emit as many boxes as fit into the remaining batch under
+		 * a single reservation, counting the visible ones first so
+		 * that we reserve exactly what we emit.
+		 */
+		n = intel_batch_space(intel) / (6*4);
+		if (n == 0) {
+			intel_batch_submit(scrn);
+			n = intel_batch_space(intel) / (6*4);
+		}
+		if (n > nbox)
+			n = nbox;
+
+		count = 0;
+		for (i = 0; i < n; i++)
+			count += intel_uxa_clip_box(pixmap, &box[i], &clip);
+
+		if (count) {
+			BEGIN_BATCH_BLT(6*count);
+			for (i = 0; i < n; i++) {
+				if (!intel_uxa_clip_box(pixmap, &box[i], &clip))
+					continue;
+
+				OUT_BATCH(cmd);
+				OUT_BATCH(intel->BR[13] | pitch);
+				OUT_BATCH((clip.y1 << 16) | (clip.x1 & 0xffff));
+				OUT_BATCH((clip.y2 << 16) | (clip.x2 & 0xffff));
+				OUT_RELOC_PIXMAP_FENCED(pixmap,
+							I915_GEM_DOMAIN_RENDER,
+							I915_GEM_DOMAIN_RENDER,
+							0);
+				OUT_BATCH(intel->BR[16]);
+			}
+			ADVANCE_BATCH();
+		}
 
-		OUT_BATCH(intel->BR[13] | pitch);
-		OUT_BATCH((y1 << 16) | (x1 & 0xffff));
-		OUT_BATCH((y2 << 16) | (x2 & 0xffff));
-		OUT_RELOC_PIXMAP_FENCED(pixmap, I915_GEM_DOMAIN_RENDER,
-					I915_GEM_DOMAIN_RENDER, 0);
-		OUT_BATCH(intel->BR[16]);
-		ADVANCE_BATCH();
+		box += n;
+		nbox -= n;
 	}
 }
 
+static void intel_uxa_solid(PixmapPtr pixmap, int x1, int y1, int x2, int y2)
+{
+	BoxRec box;
+
+	box.x1 = x1;
+	box.y1 = y1;
+	box.x2 = x2;
+	box.y2 = y2;
+
+	intel_uxa_solid_boxes(pixmap, &box, 1);
+}
+
 /**
  * TODO:
  *   - support planemask using FULL_BLT_CMD?
@@ -772,6 +818,148 @@ static Bool intel_uxa_pixmap_put_image(PixmapPtr pixmap,
 	return ret;
 }
 
+#define UPLOAD_BO_SIZE (256*1024)
+
+static dri_bo *intel_uxa_upload_bo(intel_screen_private *intel, int size)
+{
+	struct intel_upload *upload = &intel->upload;
+	dri_bo *bo;
+
+	if (upload->used + size > UPLOAD_BO_SIZE) {
+		upload->current = (upload->current + 1) % ARRAY_SIZE(upload->bo);
+		upload->used = 0;
+	}
+
+	bo = upload->bo[upload->current];
+	if (upload->used == 0 && bo &&
+	    (drm_intel_bo_busy(bo) ||
+	     drm_intel_bo_references(intel->batch_bo, bo))) {
+		/* Still in flight, or about to be read by blits queued in
+		 * the current batch; leave it for libdrm to reap.
+		 */
+		dri_bo_unreference(bo);
+		bo = NULL;
+	}
+
+	if (bo == NULL) {
+		bo = dri_bo_alloc(intel->bufmgr, "upload", UPLOAD_BO_SIZE, 4096);
+		upload->bo[upload->current] = bo;
+	}
+
+	return bo;
+}
+
+static Bool intel_uxa_put_image_blt(PixmapPtr pixmap,
+				    int x, int y,
+				    int w, int h,
+				    char *src, int src_pitch)
+{
+	ScrnInfoPtr scrn = xf86ScreenToScrn(pixmap->drawable.pScreen);
+	intel_screen_private *intel = intel_get_screen_private(scrn);
+	int cpp = pixmap->drawable.bitsPerPixel/8;
+	int pitch = ALIGN(w * cpp, 4);
+	int size = ALIGN(pitch * h, 64);
+	unsigned int dst_pitch;
+	uint32_t offset, cmd;
+	drm_intel_bo *bo_table[] = {
+		NULL,		/* batch_bo */
+		NULL,		/* upload */
+		intel_get_pixmap_bo(pixmap),
+	};
+	dri_bo *bo;
+
+	if (size > UPLOAD_BO_SIZE || pitch > 32767)
+		return FALSE;
+
+	if (!intel_check_pitch_2d(pixmap))
+		return FALSE;
+
+	bo = intel_uxa_upload_bo(intel, size);
+	if (bo == NULL)
+		return FALSE;
+
+	bo_table[1] = bo;
+	if (!intel_get_aperture_space(scrn, bo_table, ARRAY_SIZE(bo_table)))
+		return FALSE;
+
+	/* Making room may have submitted the batch, and with it the
+	 * staging buffer.
+	 */
+	if (bo != intel->upload.bo[intel->upload.current]) {
+		bo = intel_uxa_upload_bo(intel, size);
+		if (bo == NULL)
+			return FALSE;
+	}
+
+	offset = intel->upload.used;
+	if (h == 1 || src_pitch == pitch) {
+		if (drm_intel_bo_subdata(bo, offset, pitch*(h-1) + w*cpp, src))
+			return FALSE;
+	} else {
+		char *dst;
+		int row_length = w * cpp;
+		int num_rows = h;
+
+		if (drm_intel_gem_bo_map_gtt(bo))
+			return FALSE;
+
+		dst = (char *)bo->virtual + offset;
+		do {
+			memcpy(dst, src, row_length);
+			src += src_pitch;
+			dst += pitch;
+		} while (--num_rows);
+		drm_intel_gem_bo_unmap_gtt(bo);
+	}
+	intel->upload.used += size;
+
+	dst_pitch = intel_pixmap_pitch(pixmap);
+
+	{
+		BEGIN_BATCH_BLT(8);
+
+		cmd = XY_SRC_COPY_BLT_CMD;
+
+		if (pixmap->drawable.bitsPerPixel == 32)
+			cmd |=
+			    XY_SRC_COPY_BLT_WRITE_ALPHA |
+			    XY_SRC_COPY_BLT_WRITE_RGB;
+
+		if (INTEL_INFO(intel)->gen >= 40 && intel_pixmap_tiled(pixmap)) {
+			assert((dst_pitch % 512) == 0);
+			dst_pitch >>= 2;
+			cmd |= XY_SRC_COPY_BLT_DST_TILED;
+		}
+
+		OUT_BATCH(cmd);
+
+		cmd = I830CopyROP[GXcopy] << 16 | dst_pitch;
+		switch (pixmap->drawable.bitsPerPixel) {
+		case 16:
+			cmd |= (1 << 24);
+			break;
+		case 32:
+			cmd |= ((1 << 25) | (1 << 24));
+			break;
+		}
+		OUT_BATCH(cmd);
+		OUT_BATCH((y << 16) | (x & 0xffff));
+		OUT_BATCH(((y + h) << 16) | ((x + w) & 0xffff));
+		OUT_RELOC_PIXMAP_FENCED(pixmap,
+					I915_GEM_DOMAIN_RENDER,
+					I915_GEM_DOMAIN_RENDER,
+					0);
+		OUT_BATCH(0);
+		OUT_BATCH(pitch);
+		OUT_RELOC(bo, I915_GEM_DOMAIN_RENDER, 0, offset);
+
+		ADVANCE_BATCH();
+	}
+
+	intel_uxa_done(pixmap);
+	return TRUE;
+}
+
 static Bool intel_uxa_put_image(PixmapPtr pixmap,
 				int x, int y,
 				int w, int h,
@@ -825,6 +1013,11 @@ static Bool intel_uxa_put_image(PixmapPtr pixmap,
 			PixmapPtr scratch;
 			Bool ret;
 
+			/* Write into a staging buffer and queue a blit. */
+			if (intel_uxa_put_image_blt(pixmap, x, y, w, h,
+						    src, src_pitch))
+				return TRUE;
+
 			/* Upload to a linear buffer and queue a blit.  */
 			scratch = (*screen->CreatePixmap)(screen, w, h,
 							  pixmap->drawable.depth,
@@ -872,7 +1065,10 @@ static Bool intel_uxa_pixmap_get_image(PixmapPtr pixmap,
 	} else {
 		char *src;
 
-		if (drm_intel_gem_bo_map_gtt(priv->bo))
+		/* Reads through the GTT are uncached and painfully slow, so
+		 * read the (linear) bo through a cacheable CPU mapping.
+		 */
+		if (drm_intel_bo_map(priv->bo, FALSE))
 		    return FALSE;
 
 		src = (char *) priv->bo->virtual + y * stride + x * cpp;
@@ -883,7 +1079,7 @@ static Bool intel_uxa_pixmap_get_image(PixmapPtr pixmap,
 			dst += dst_pitch;
 		} while (--h);
 
-		drm_intel_gem_bo_unmap_gtt(priv->bo);
+		drm_intel_bo_unmap(priv->bo);
 
 		return TRUE;
 	}
@@ -969,6 +1165,11 @@ static CARD32 intel_cache_expire(OsTimerPtr timer, CARD32 now, pointer data)
 
 static void intel_flush_rendering(intel_screen_private *intel)
 {
+	if (intel->flush_armed) {
+		TimerCancel(intel->flush_timer);
+		intel->flush_armed = FALSE;
+	}
+
 	if (intel->needs_flush == 0)
 		return;
 
@@ -991,13 +1192,53 @@ static void intel_throttle(intel_screen_private *intel)
 	drmCommandNone(intel->drmSubFD, DRM_I915_GEM_THROTTLE);
 }
 
+/* Half a frame at 60Hz: long enough to gather the rendering from many
+ * small requests into a single batch, short enough that it still
+ * reaches the scanout in time for the next frame.
+ */
+#define FLUSH_INTERVAL 8
+
+static CARD32 intel_flush_expire(OsTimerPtr timer, CARD32 now, pointer data)
+{
+	intel_screen_private *intel = data;
+
+	intel->flush_armed = FALSE;
+	if (intel->scrn->vtSema && intel->needs_flush) {
+		intel_flush_rendering(intel);
+		intel_throttle(intel);
+	}
+
+	return 0;
+}
+
 void intel_uxa_block_handler(intel_screen_private *intel)
 {
+	intel_glamor_flush(intel);
+
+	if (intel->needs_flush == 0)
+		return;
+
 	/* Emit a flush of the rendering cache, or on the 965
 	 * and beyond rendering results may not hit the
 	 * framebuffer until significantly later.
+	 *
+	 * If the batch has already been submitted (by the flush
+	 * callback, as a client is waiting on a reply), we only have
+	 * to flush the caches. Otherwise rather than submitting upon
+	 * every wakeup, let the rendering accumulate until the
+	 * deadline and so batch together the work of many small
+	 * requests.
 	 */
-	intel_glamor_flush(intel);
+	if (intel->batch_used) {
+		if (!intel->flush_armed) {
+			intel->flush_timer = TimerSet(intel->flush_timer, 0,
+						      FLUSH_INTERVAL,
+						      intel_flush_expire, intel);
+			intel->flush_armed = TRUE;
+		}
+		return;
+	}
+
 	intel_flush_rendering(intel);
 	intel_throttle(intel);
 }
@@ -1322,6 +1563,8 @@ Bool intel_uxa_init(ScreenPtr screen)
 	intel->floats_per_vertex = 0;
 	intel->last_floats_per_vertex = 0;
 	intel->vertex_bo = NULL;
+	intel->last_vertex_bo = NULL;
+	intel->vertex_base = 0;
 	intel->surface_used = 0;
 	intel->surface_reloc = 0;
 
@@ -1329,6 +1572,7 @@ Bool intel_uxa_init(ScreenPtr screen)
 	intel->uxa_driver->check_solid = intel_uxa_check_solid;
 	intel->uxa_driver->prepare_solid = intel_uxa_prepare_solid;
 	intel->uxa_driver->solid = intel_uxa_solid;
+	intel->uxa_driver->solid_boxes = intel_uxa_solid_boxes;
 	intel->uxa_driver->done_solid = intel_uxa_done;
 
 	/* Copy */
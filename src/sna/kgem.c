@@ -160,6 +160,7 @@ static void kgem_sna_reset(struct kgem *kgem)
 
 	sna->render.reset(sna);
 	sna->blt_state.fill_bo = 0;
+	sna->blt_state.copy_end = 0;
 }
 
 static void kgem_sna_flush(struct kgem *kgem)
@@ -1675,10 +1676,22 @@ static bool kgem_retire__flushing(struct kgem *kgem)
 	return retired;
 }
 
+static void kgem_update_latency(struct kgem *kgem, uint32_t elapsed)
+{
+	/* We only notice completion when we next look, so this is an
+	 * upper bound on the true latency - which is what matters when
+	 * deciding how long to wait before looking again.
+	 */
+	if (elapsed > 1000)
+		elapsed = 1000;
+	kgem->retire_latency = (7 * kgem->retire_latency + (elapsed << 4)) / 8;
+}
+
 static bool kgem_retire__requests(struct kgem *kgem)
 {
 	struct kgem_bo *bo;
 	bool retired = false;
+	uint32_t now = 0;
 	int n;
 
 	for (n = 0; n < ARRAY_SIZE(kgem->requests); n++) {
@@ -1694,6 +1707,10 @@ static bool kgem_retire__requests(struct kgem *kgem)
 			DBG(("%s: request %d complete\n",
 			     __FUNCTION__, rq->bo->handle));
 
+			if (now == 0)
+				now = GetTimeInMillis();
+			kgem_update_latency(kgem, now - rq->submit_time);
+
 			while (!list_is_empty(&rq->buffers)) {
 				bo = list_first_entry(&rq->buffers,
 						      struct kgem_bo,
@@ -2257,6 +2274,8 @@ void _kgem_submit(struct kgem *kgem)
 		rq->bo->rq = rq; /* useful sanity check */
 		list_add(&rq->bo->request, &rq->buffers);
 		rq->ring = kgem->ring == KGEM_BLT;
+		rq->submit_time = GetTimeInMillis();
+		kgem->nsubmit++;
 
 		kgem_fixup_self_relocs(kgem, rq->bo);
 
@@ -98,6 +98,7 @@ struct kgem_request {
 	struct kgem_bo *bo;
 	struct list buffers;
 	int ring;
+	uint32_t submit_time; /* ms */
 };
 
 enum {
@@ -133,6 +134,13 @@ struct kgem {
 	struct kgem_request *next_request;
 	uint32_t num_requests;
 
+	/* Running estimate of how long a batch takes from submission to
+	 * being seen retired, in 1/16ths of a millisecond, used to pace
+	 * the flush and throttle timers.
+	 */
+	uint32_t retire_latency;
+	uint32_t nsubmit;
+
 	struct {
 		struct list inactive[NUM_CACHE_BUCKETS];
 		int16_t count;
@@ -101,6 +101,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "intel_list.h"
 #include "kgem.h"
 #include "sna_damage.h"
+#include "sna_migrate.h"
+#include "sna_profile.h"
+#include "sna_fallback.h"
 #include "sna_render.h"
 #include "fb/fb.h"
 
@@ -133,6 +136,8 @@ struct sna_pixmap {
 	uint8_t create :3;
 	uint8_t header :1;
 	uint8_t cpu :1;
+
+	struct sna_migrate_history migrate;
 };
 
 struct sna_glyph {
@@ -184,6 +189,7 @@ enum {
 	FLUSH_TIMER = 0,
 	THROTTLE_TIMER,
 	EXPIRE_TIMER,
+	STATS_TIMER,
 #if DEBUG_MEMORY
 	DEBUG_MEMORY_TIMER,
 #endif
@@ -200,6 +206,9 @@ struct sna {
 #define SNA_NO_FLIP		0x8
 #define SNA_TEAR_FREE		0x10
 #define SNA_FORCE_SHADOW	0x20
+#define SNA_REPORT_STATS	0x40
+#define SNA_TRIPLE_BUFFER	0x80
+#define SNA_PROFILE		0x100
 
 	unsigned watch_flush;
 
@@ -207,6 +216,15 @@ struct sna {
 	uint32_t timer_expire[NUM_TIMERS];
 	uint16_t timer_active;
 
+	struct sna_timer_stats {
+		uint32_t nsubmit; /* at the last flush */
+		uint32_t submit_rate; /* batches per flush, in 1/16ths */
+		struct sna_timer_interval {
+			unsigned count, min, max;
+			uint64_t sum;
+		} flush, throttle;
+	} timer_stats;
+
 	int vblank_interval;
 
 	struct list flush_pixmaps;
@@ -222,6 +240,8 @@ struct sna {
 		DamagePtr shadow_damage;
 		struct kgem_bo *shadow;
 		int shadow_flip;
+		unsigned shadow_frames;
+		uint64_t shadow_bytes;
 
 		struct list outputs;
 		struct list crtcs;
@@ -229,6 +249,7 @@ struct sna {
 
 	struct sna_dri {
 		void *flip_pending;
+		struct list stats;
 	} dri;
 
 	unsigned int tiling;
@@ -250,6 +271,7 @@ struct sna {
 		uint32_t fill_bo;
 		uint32_t fill_pixel;
 		uint32_t fill_alu;
+		uint32_t copy_end;
 	} blt_state;
 	union {
 		struct gen2_render_state gen2;
@@ -279,6 +301,43 @@ struct sna {
 	struct kgem kgem;
 	struct sna_render render;
 
+	struct sna_readback {
+		PixmapPtr pixmap;
+		DamagePtr damage;
+		struct kgem_bo *bo;
+		BoxRec box;
+		uint32_t time;
+		bool stale;
+		unsigned hits, misses, issued;
+	} readback;
+
+	struct sna_upload {
+		uint32_t batch; /* kgem.nsubmit of the last queued upload */
+		unsigned count, coalesced;
+		uint64_t bytes;
+	} upload;
+
+	struct sna_pattern_cache {
+		struct sna_pattern {
+			struct kgem_bo *bo;
+			uint32_t checksum;
+			int bpp;
+			uint8_t data[8*8*4];
+		} entry[16];
+		unsigned next;
+		unsigned hits, misses;
+	} patterns;
+
+	struct {
+		const struct sna_migrate_policy *policy;
+		FILE *trace;
+		unsigned count[2], refused;
+		uint64_t bytes[2];
+	} migrate;
+
+	struct sna_profile profile;
+	struct sna_fallback_stats fallback;
+
 #if DEBUG_MEMORY
 	struct {
 	       int shadow_pixels_allocs;
@@ -295,6 +354,7 @@ extern void sna_mode_update(struct sna *sna);
 extern void sna_mode_disable_unused(struct sna *sna);
 extern void sna_mode_wakeup(struct sna *sna);
 extern void sna_mode_redisplay(struct sna *sna);
+extern void sna_mode_report_stats(struct sna *sna);
 extern void sna_mode_fini(struct sna *sna);
 
 extern int sna_page_flip(struct sna *sna,
@@ -332,6 +392,32 @@ to_sna_from_kgem(struct kgem *kgem)
 	return container_of(kgem, struct sna, kgem);
 }
 
+static inline void
+sna_fallback_reason(struct sna *sna, enum sna_fallback_reason reason)
+{
+	sna->fallback.pending = reason;
+}
+
+static inline void
+sna_fallback_clear(struct sna *sna)
+{
+	sna->fallback.pending = FALLBACK_DECLINED;
+}
+
+static inline void
+sna_fallback_record(struct sna *sna, const BoxRec *box)
+{
+	struct sna_fallback_counter *c =
+		&sna->fallback.reason[sna->fallback.pending];
+
+	c->count++;
+	if (box->x2 > box->x1 && box->y2 > box->y1)
+		c->pixels += (uint64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+
+	sna_fallback_clear(sna);
+	sna_profile_fallback(&sna->profile);
+}
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 #endif
@@ -360,12 +446,14 @@ bool sna_dri_open(struct sna *sna, ScreenPtr pScreen);
 void sna_dri_page_flip_handler(struct sna *sna, struct drm_event_vblank *event);
 void sna_dri_vblank_handler(struct sna *sna, struct drm_event_vblank *event);
 void sna_dri_destroy_window(WindowPtr win);
+void sna_dri_report_stats(struct sna *sna);
 void sna_dri_close(struct sna *sna, ScreenPtr pScreen);
 #else
 static inline bool sna_dri_open(struct sna *sna, ScreenPtr pScreen) { return false; }
 static inline void sna_dri_page_flip_handler(struct sna *sna, struct drm_event_vblank *event) { }
 static inline void sna_dri_vblank_handler(struct sna *sna, struct drm_event_vblank *event) { }
 static inline void sna_dri_destroy_window(WindowPtr win) { }
+static inline void sna_dri_report_stats(struct sna *sna) { }
 static inline void sna_dri_close(struct sna *sna, ScreenPtr pScreen) { }
 #endif
 void sna_dri_pixmap_update_bo(struct sna *sna, PixmapPtr pixmap);
@@ -32,6 +32,7 @@
 #include "sna.h"
 #include "sna_reg.h"
 #include "rop.h"
+#include "intel_options.h"
 
 #include <X11/fonts/font.h>
 #include <X11/fonts/fontstruct.h>
@@ -50,6 +51,8 @@
 #include <sys/time.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
 
 #define FORCE_INPLACE 0
 #define FORCE_FALLBACK 0
@@ -58,7 +61,9 @@
 #define DEFAULT_TILING I915_TILING_X
 
 #define USE_INPLACE 1
+#define USE_STREAM_UPLOAD 1
 #define USE_WIDE_SPANS 0 /* -1 force CPU, 1 force GPU */
+#define USE_WIDE_RECTS 1
 #define USE_ZERO_SPANS 1 /* -1 force CPU, 1 force GPU */
 #define USE_CPU_BO 1
 
@@ -1399,6 +1404,79 @@ static inline bool use_cpu_bo_for_upload(struct sna *sna,
 	return kgem_bo_is_busy(priv->gpu_bo) || kgem_bo_is_busy(priv->cpu_bo);
 }
 
+static void
+sna_migration_init(struct sna_migration *m,
+		   PixmapPtr pixmap, unsigned op, unsigned dir,
+		   const BoxRec *box, int n,
+		   const char *reason)
+{
+	uint64_t pixels = 0;
+
+	while (n--) {
+		pixels += (box->x2 - box->x1) * (box->y2 - box->y1);
+		box++;
+	}
+
+	m->time = currentTime.milliseconds;
+	m->pixmap = pixmap->drawable.serialNumber;
+	m->bytes = pixels * pixmap->drawable.bitsPerPixel >> 3;
+	m->op = op;
+	m->dir = dir;
+	m->optional = false;
+	m->allowed = true;
+	m->reason = reason;
+}
+
+static void
+sna_pixmap_migrated(struct sna *sna, PixmapPtr pixmap,
+		    unsigned op, unsigned dir,
+		    const BoxRec *box, int n,
+		    const char *reason)
+{
+	struct sna_pixmap *priv = sna_pixmap(pixmap);
+	struct sna_migration m;
+
+	sna_migration_init(&m, pixmap, op, dir, box, n, reason);
+	DBG(("%s: pixmap=%ld, %s to %s, %d bytes: %s\n",
+	     __FUNCTION__, pixmap->drawable.serialNumber,
+	     sna_migrate_op_name(op), dir == MIGRATE_TO_GPU ? "gpu" : "cpu",
+	     m.bytes, reason));
+
+	sna_migrate_update(sna->migrate.policy, &priv->migrate, &m);
+	sna->migrate.count[dir]++;
+	sna->migrate.bytes[dir] += m.bytes;
+
+	if (sna->migrate.trace)
+		sna_migrate_trace_write(sna->migrate.trace, &m);
+}
+
+/* Ask the migration policy whether we may move the pixmap when the
+ * caller has an alternative to doing so.
+ */
+static bool
+sna_pixmap_migrate_allowed(struct sna *sna, PixmapPtr pixmap,
+			   unsigned dir, const BoxRec *box,
+			   const char *reason)
+{
+	struct sna_pixmap *priv = sna_pixmap(pixmap);
+	struct sna_migration m;
+
+	sna_migration_init(&m, pixmap, MIGRATE_USE_BO, dir, box, 1, reason);
+	m.optional = true;
+	if (!sna_migrate_decide(sna->migrate.policy, &priv->migrate, &m)) {
+		DBG(("%s: pixmap=%ld, refusing to migrate to %s within %dms of the last migration (reversals=%d)\n",
+		     __FUNCTION__, pixmap->drawable.serialNumber,
+		     dir == MIGRATE_TO_GPU ? "gpu" : "cpu",
+		     m.time - priv->migrate.time, priv->migrate.reversals));
+		sna->migrate.refused++;
+	}
+
+	if (sna->migrate.trace)
+		sna_migrate_trace_write(sna->migrate.trace, &m);
+
+	return m.allowed;
+}
+
 static inline bool operate_inplace(struct sna_pixmap *priv, unsigned flags)
 {
 	if ((flags & MOVE_INPLACE_HINT) == 0 || priv->gpu_bo == NULL)
@@ -1609,6 +1687,10 @@ skip_inplace_map:
 					       priv->gpu_bo, 0, 0,
 					       pixmap, 0, 0,
 					       box, n);
+			sna_pixmap_migrated(sna, pixmap,
+					    MIGRATE_MOVE_TO_CPU, MIGRATE_TO_CPU,
+					    box, n,
+					    flags & MOVE_WRITE ? "write" : "read");
 		}
 
 		__sna_damage_destroy(DAMAGE_PTR(priv->gpu_damage));
@@ -2034,6 +2116,9 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 					       priv->gpu_bo, 0, 0,
 					       pixmap, 0, 0,
 					       box, n);
+			sna_pixmap_migrated(sna, pixmap,
+					    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+					    box, n, "forced migration");
 		}
 		sna_damage_destroy(&priv->gpu_damage);
 		priv->undamaged = true;
@@ -2057,6 +2142,10 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 					       priv->gpu_bo, 0, 0,
 					       pixmap, 0, 0,
 					       &region->extents, 1);
+				sna_pixmap_migrated(sna, pixmap,
+						    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+						    &region->extents, 1,
+						    "single pixel read");
 				goto done;
 			}
 		} else {
@@ -2084,6 +2173,10 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 					       priv->gpu_bo, 0, 0,
 					       pixmap, 0, 0,
 					       &region->extents, 1);
+				sna_pixmap_migrated(sna, pixmap,
+						    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+						    &region->extents, 1,
+						    "single pixel read");
 				goto done;
 			}
 
@@ -2145,6 +2238,10 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 							       priv->gpu_bo, 0, 0,
 							       pixmap, 0, 0,
 							       box, n);
+					sna_pixmap_migrated(sna, pixmap,
+							    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+							    box, n,
+							    "region contains damage");
 				}
 
 				sna_damage_destroy(&priv->gpu_damage);
@@ -2171,6 +2268,10 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 						       priv->gpu_bo, 0, 0,
 						       pixmap, 0, 0,
 						       box, n);
+				sna_pixmap_migrated(sna, pixmap,
+						    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+						    box, n,
+						    "region inside damage");
 
 				sna_damage_subtract(&priv->gpu_damage, r);
 				priv->undamaged = true;
@@ -2198,6 +2299,10 @@ sna_drawable_move_region_to_cpu(DrawablePtr drawable,
 							       priv->gpu_bo, 0, 0,
 							       pixmap, 0, 0,
 							       box, n);
+					sna_pixmap_migrated(sna, pixmap,
+							    MIGRATE_MOVE_REGION_TO_CPU, MIGRATE_TO_CPU,
+							    box, n,
+							    "region intersects damage");
 
 					sna_damage_subtract(&priv->gpu_damage, r);
 					priv->undamaged = true;
@@ -2465,6 +2570,9 @@ sna_pixmap_move_area_to_gpu(PixmapPtr pixmap, const BoxRec *box, unsigned int fl
 				if (!ok)
 					return false;
 			}
+			sna_pixmap_migrated(sna, pixmap,
+					    MIGRATE_MOVE_AREA_TO_GPU, MIGRATE_TO_GPU,
+					    box, n, "area contains damage");
 		}
 
 		sna_damage_destroy(&priv->cpu_damage);
@@ -2500,6 +2608,9 @@ sna_pixmap_move_area_to_gpu(PixmapPtr pixmap, const BoxRec *box, unsigned int fl
 		}
 		if (!ok)
 			return false;
+		sna_pixmap_migrated(sna, pixmap,
+				    MIGRATE_MOVE_AREA_TO_GPU, MIGRATE_TO_GPU,
+				    box, 1, "area inside damage");
 
 		sna_damage_subtract(&priv->cpu_damage, &r);
 		priv->undamaged = true;
@@ -2536,6 +2647,9 @@ sna_pixmap_move_area_to_gpu(PixmapPtr pixmap, const BoxRec *box, unsigned int fl
 		}
 		if (!ok)
 			return false;
+		sna_pixmap_migrated(sna, pixmap,
+				    MIGRATE_MOVE_AREA_TO_GPU, MIGRATE_TO_GPU,
+				    box, n, "area intersects damage");
 
 		sna_damage_subtract(&priv->cpu_damage, &r);
 		priv->undamaged = true;
@@ -2680,6 +2794,14 @@ sna_drawable_use_bo(DrawablePtr drawable, unsigned flags, const BoxRec *box,
 					     __FUNCTION__));
 					goto use_cpu_bo;
 				}
+
+				if (!sna_pixmap_migrate_allowed(to_sna_from_pixmap(pixmap),
+								pixmap, MIGRATE_TO_GPU, box,
+								"allocate gpu bo")) {
+					DBG(("%s: migration refused by policy\n",
+					     __FUNCTION__));
+					goto use_cpu_bo;
+				}
 			}
 		} else if (priv->cpu_damage) {
 			get_drawable_deltas(drawable, pixmap, &dx, &dy);
@@ -2772,6 +2894,18 @@ create_gpu_bo:
 	}
 
 move_to_gpu:
+	if ((flags & (FORCE_GPU | IGNORE_CPU)) == 0 && priv->cpu_damage &&
+	    sna_damage_overlaps_box(priv->cpu_damage, &region.extents) &&
+	    !sna_pixmap_migrate_allowed(to_sna_from_pixmap(pixmap),
+					pixmap, MIGRATE_TO_GPU, &region.extents,
+					"upload cpu damage")) {
+		/* use_cpu_bo may bounce straight back here, and the policy
+		 * would only refuse again; let the caller fall back instead.
+		 */
+		DBG(("%s: migration refused by policy\n", __FUNCTION__));
+		return NULL;
+	}
+
 	if (!sna_pixmap_move_area_to_gpu(pixmap, &region.extents,
 					 flags & IGNORE_CPU ? MOVE_WRITE : MOVE_READ | MOVE_WRITE)) {
 		DBG(("%s: failed to move-to-gpu, fallback\n", __FUNCTION__));
@@ -3131,6 +3265,10 @@ sna_pixmap_move_to_gpu(PixmapPtr pixmap, unsigned flags)
 			if (!ok)
 				return NULL;
 		}
+		sna_pixmap_migrated(sna, pixmap,
+				    MIGRATE_MOVE_TO_GPU, MIGRATE_TO_GPU,
+				    box, n,
+				    flags & MOVE_WRITE ? "write" : "read");
 	}
 
 	__sna_damage_destroy(DAMAGE_PTR(priv->cpu_damage));
@@ -3381,7 +3519,8 @@ sna_put_image_upload_blt(DrawablePtr drawable, GCPtr gc, RegionPtr region,
 	struct sna *sna = to_sna_from_pixmap(pixmap);
 	struct sna_pixmap *priv = sna_pixmap(pixmap);
 	BoxPtr box;
-	int nbox;
+	int nbox, nbatch;
+	uint32_t nsubmit;
 	int16_t dx, dy;
 
 	box = REGION_RECTS(region);
@@ -3404,17 +3543,43 @@ sna_put_image_upload_blt(DrawablePtr drawable, GCPtr gc, RegionPtr region,
 	if (!priv->pinned && nbox == 1 &&
 	    box->x1 <= 0 && box->y1 <= 0 &&
 	    box->x2 >= pixmap->drawable.width &&
-	    box->y2 >= pixmap->drawable.height)
-		return sna_replace(sna, pixmap, &priv->gpu_bo, bits, stride);
+	    box->y2 >= pixmap->drawable.height) {
+		if (!sna_replace(sna, pixmap, &priv->gpu_bo, bits, stride))
+			return false;
+
+		sna->upload.count++;
+		sna->upload.bytes += (uint64_t)pixmap->drawable.height *
+			pixmap->drawable.width * pixmap->drawable.bitsPerPixel >> 3;
+		return true;
+	}
 
 	get_drawable_deltas(drawable, pixmap, &dx, &dy);
 	x += dx + drawable->x;
 	y += dy + drawable->y;
 
-	return sna_write_boxes(sna, pixmap,
-			       priv->gpu_bo, 0, 0,
-			       bits, stride, -x, -y,
-			       box, nbox);
+	nsubmit = sna->kgem.nsubmit;
+	nbatch = sna->kgem.nbatch;
+	if (!sna_write_boxes(sna, pixmap,
+			     priv->gpu_bo, 0, 0,
+			     bits, stride, -x, -y,
+			     box, nbox))
+		return false;
+
+	/* Did we queue a blit from a staging buffer alongside the
+	 * previous upload, rather than write directly or flush?
+	 */
+	if (sna->kgem.nsubmit == nsubmit && sna->kgem.nbatch > nbatch) {
+		if (sna->upload.batch == nsubmit && nbatch)
+			sna->upload.coalesced++;
+		sna->upload.batch = nsubmit;
+	}
+	sna->upload.count++;
+	while (nbox--) {
+		sna->upload.bytes += (uint64_t)(box->x2 - box->x1) *
+			(box->y2 - box->y1) * pixmap->drawable.bitsPerPixel >> 3;
+		box++;
+	}
+	return true;
 }
 
 static bool upload_inplace(struct sna *sna,
@@ -3500,6 +3665,55 @@ static bool upload_inplace(struct sna *sna,
 	return false;
 }
 
+/* Should we stream the image to a pixmap that lives on the GPU?
+ *
+ * When we cannot write into the GPU bo directly (it is busy or cannot be
+ * mapped), the fallback is to move the region to the CPU and so split
+ * the pixmap between the two, only for the next GPU operation to upload
+ * it again. Instead, copy the image into a staging buffer and queue a
+ * blit. kgem packs consecutive small uploads into the same staging
+ * buffer and their blits into the same batch, so a stream of PutImage
+ * requests costs a memcpy each and no stalls.
+ */
+static bool upload_stream(struct sna *sna,
+			  PixmapPtr pixmap,
+			  struct sna_pixmap *priv,
+			  RegionRec *region)
+{
+	const BoxRec *box;
+	uint64_t bytes;
+
+	if (!USE_STREAM_UPLOAD)
+		return false;
+
+	if (priv->shm || priv->gpu_bo == NULL || priv->gpu_bo->proxy) {
+		DBG(("%s: no, not a GPU pixmap\n", __FUNCTION__));
+		return false;
+	}
+
+	if (priv->cpu_damage) {
+		DBG(("%s: no, pixmap has CPU damage\n", __FUNCTION__));
+		return false;
+	}
+
+	if (!kgem_bo_can_blt(&sna->kgem, priv->gpu_bo)) {
+		DBG(("%s: no, cannot blit to GPU bo\n", __FUNCTION__));
+		return false;
+	}
+
+	box = RegionExtents(region);
+	bytes = (uint64_t)(box->x2 - box->x1) * (box->y2 - box->y1) *
+		pixmap->drawable.bitsPerPixel >> 3;
+	if (bytes > sna->kgem.max_upload_tile_size) {
+		DBG(("%s: no, too large for a single staging buffer (%lld > %d)\n",
+		     __FUNCTION__, (long long)bytes, sna->kgem.max_upload_tile_size));
+		return false;
+	}
+
+	DBG(("%s: yes, %d bytes\n", __FUNCTION__, (int)bytes));
+	return true;
+}
+
 static bool
 sna_put_zpixmap_blt(DrawablePtr drawable, GCPtr gc, RegionPtr region,
 		    int x, int y, int w, int  h, char *bits, int stride)
@@ -3530,7 +3744,8 @@ sna_put_zpixmap_blt(DrawablePtr drawable, GCPtr gc, RegionPtr region,
 	 * So we try again with vma caching and only for pixmaps who will be
 	 * immediately flushed...
 	 */
-	if (upload_inplace(sna, pixmap, priv, region) &&
+	if ((upload_inplace(sna, pixmap, priv, region) ||
+	     upload_stream(sna, pixmap, priv, region)) &&
 	    sna_put_image_upload_blt(drawable, gc, region,
 				     x, y, w, h, bits, stride)) {
 		if (!DAMAGE_IS_ALL(priv->gpu_damage)) {
@@ -4024,6 +4239,7 @@ sna_put_image(DrawablePtr drawable, GCPtr gc, int depth,
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached(%d, %d, %d, %d)\n",
 		     __FUNCTION__, x, y, w, h));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -4032,16 +4248,20 @@ sna_put_image(DrawablePtr drawable, GCPtr gc, int depth,
 	if (FORCE_FALLBACK)
 		goto fallback;
 
-	if (wedged(sna))
+	if (wedged(sna)) {
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
+	}
 
 	if (!ACCEL_PUT_IMAGE)
 		goto fallback;
 
 	switch (format) {
 	case ZPixmap:
-		if (!PM_IS_SOLID(drawable, gc->planemask))
+		if (!PM_IS_SOLID(drawable, gc->planemask)) {
+			sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 			goto fallback;
+		}
 
 		if (sna_put_zpixmap_blt(drawable, gc, &region,
 					x, y, w, h,
@@ -4050,8 +4270,10 @@ sna_put_image(DrawablePtr drawable, GCPtr gc, int depth,
 		break;
 
 	case XYBitmap:
-		if (!PM_IS_SOLID(drawable, gc->planemask))
+		if (!PM_IS_SOLID(drawable, gc->planemask)) {
+			sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 			goto fallback;
+		}
 
 		if (sna_put_xybitmap_blt(drawable, gc, &region,
 					 x, y, w, h,
@@ -4074,6 +4296,7 @@ fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
 	RegionTranslate(&region, -dx, -dy);
 
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -4228,8 +4451,10 @@ sna_self_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	if (dst != src)
 		get_drawable_deltas(dst, pixmap, &tx, &ty);
 
-	if (priv == NULL || DAMAGE_IS_ALL(priv->cpu_damage))
+	if (priv == NULL || DAMAGE_IS_ALL(priv->cpu_damage)) {
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
+	}
 
 	if (priv->gpu_damage) {
 		if (alu == GXcopy && priv->clear)
@@ -4239,6 +4464,7 @@ sna_self_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 		if (!sna_pixmap_move_to_gpu(pixmap, MOVE_WRITE | MOVE_READ)) {
 			DBG(("%s: fallback - not a pure copy and failed to move dst to GPU\n",
 			     __FUNCTION__));
+			sna_fallback_reason(sna, FALLBACK_MIGRATE);
 			goto fallback;
 		}
 
@@ -4259,6 +4485,7 @@ sna_self_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	} else {
 fallback:
 		DBG(("%s: fallback", __FUNCTION__));
+		sna_fallback_record(sna, &region->extents);
 		if (!sna_pixmap_move_to_cpu(pixmap, MOVE_READ | MOVE_WRITE))
 			goto out;
 
@@ -4412,8 +4639,10 @@ sna_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	     src_priv ? src_priv->cpu_bo : NULL,
 	     replaces));
 
-	if (dst_priv == NULL)
+	if (dst_priv == NULL) {
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
+	}
 
 	hint = source_prefer_gpu(src_priv) ?:
 		region_inplace(sna, dst_pixmap, region,
@@ -4505,8 +4734,10 @@ sna_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 			area.y2 += src_dy;
 
 			if (!sna_pixmap_move_area_to_gpu(src_pixmap, &area,
-							 MOVE_READ))
+							 MOVE_READ)) {
+				sna_fallback_reason(sna, FALLBACK_MIGRATE);
 				goto fallback;
+			}
 
 			if (!sna->render.copy_boxes(sna, alu,
 						    src_pixmap, src_priv->gpu_bo, src_dx, src_dy,
@@ -4538,8 +4769,10 @@ sna_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 							      region,
 							      MOVE_READ | MOVE_ASYNC_HINT);
 			RegionTranslate(region, -src_dx, -src_dy);
-			if (!ret)
+			if (!ret) {
+				sna_fallback_reason(sna, FALLBACK_MIGRATE);
 				goto fallback;
+			}
 
 			if (!sna->render.copy_boxes(sna, alu,
 						    src_pixmap, src_priv->cpu_bo, src_dx, src_dy,
@@ -4721,6 +4954,7 @@ sna_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	}
 
 fallback:
+	sna_fallback_record(sna, &region->extents);
 	if (alu == GXcopy && src_priv && src_priv->clear) {
 		DBG(("%s: copying clear [%08x]\n",
 		     __FUNCTION__, src_priv->clear_color));
@@ -4991,6 +5225,7 @@ sna_fallback_copy_boxes(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	     region->extents.x2, region->extents.y2,
 	     dx, dy, gc->alu));
 
+	sna_fallback_record(to_sna_from_drawable(dst), &region->extents);
 	if (!sna_gc_move_to_cpu(gc, dst, region))
 		return;
 
@@ -5790,6 +6025,15 @@ done:
 	return true;
 }
 
+static bool
+sna_poly_fill_rect_blt(DrawablePtr drawable,
+		       struct kgem_bo *bo,
+		       struct sna_damage **damage,
+		       GCPtr gc, uint32_t pixel,
+		       int n, xRectangle *rect,
+		       const BoxRec *extents,
+		       bool clipped);
+
 static bool
 sna_poly_fill_rect_tiled_blt(DrawablePtr drawable,
 			     struct kgem_bo *bo,
@@ -5943,14 +6187,17 @@ sna_fill_spans(DrawablePtr drawable, GCPtr gc, int n,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	DBG(("%s: fillStyle=%x [%d], mask=%lx [%d]\n", __FUNCTION__,
 	     gc->fillStyle, gc->fillStyle == FillSolid,
 	     gc->planemask, PM_IS_SOLID(drawable, gc->planemask)));
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	bo = sna_drawable_use_bo(drawable, PREFER_GPU,
 				 &region.extents, &damage);
@@ -6003,9 +6250,12 @@ fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
 	region.data = NULL;
 	region_maybe_clip(&region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&region))
+	if (!RegionNotEmpty(&region)) {
+		sna_fallback_clear(sna);
 		return;
+	}
 
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -6043,9 +6293,12 @@ sna_set_spans(DrawablePtr drawable, GCPtr gc, char *src,
 fallback:
 	region.data = NULL;
 	region_maybe_clip(&region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&region))
+	if (!RegionNotEmpty(&region)) {
+		sna_fallback_clear(to_sna_from_drawable(drawable));
 		return;
+	}
 
+	sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -6506,11 +6759,15 @@ sna_copy_plane(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 	if (!ACCEL_COPY_PLANE)
 		goto fallback;
 
-	if (wedged(sna))
+	if (wedged(sna)) {
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
+	}
 
-	if (!PM_IS_SOLID(dst, gc->planemask))
+	if (!PM_IS_SOLID(dst, gc->planemask)) {
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	arg.bo = sna_drawable_use_bo(dst, PREFER_GPU,
 				     &region.extents, &arg.damage);
@@ -6521,6 +6778,7 @@ sna_copy_plane(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 			if (arg.bo == NULL) {
 				DBG(("%s: fallback -- unable to change tiling\n",
 				     __FUNCTION__));
+				sna_fallback_reason(sna, FALLBACK_TILING);
 				goto fallback;
 			}
 		}
@@ -6535,6 +6793,7 @@ sna_copy_plane(DrawablePtr src, DrawablePtr dst, GCPtr gc,
 
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, dst, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(dst, &region,
@@ -6722,6 +6981,7 @@ sna_poly_point(DrawablePtr drawable, GCPtr gc,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
@@ -6743,9 +7003,12 @@ fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
 	region.data = NULL;
 	region_maybe_clip(&region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&region))
+	if (!RegionNotEmpty(&region)) {
+		sna_fallback_clear(sna);
 		return;
+	}
 
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -7472,6 +7735,397 @@ use_wide_spans(DrawablePtr drawable, GCPtr gc, const BoxRec *extents)
 	return ret;
 }
 
+static enum sna_fallback_reason line_fallback_reason(GCPtr gc)
+{
+	if (gc->lineWidth > 1 || gc->lineStyle != LineSolid)
+		return FALLBACK_LINE;
+
+	return FALLBACK_CPU;
+}
+
+/* Wide rectilinear lines are just a set of rectangles. Rather than
+ * scan convert them into spans with miWideLine()/miWideDash(), we
+ * compute the same rectangles as miWideSegment() and pass them to the
+ * fill-rectangle paths. Index 0 holds the foreground (the line and
+ * even dashes), index 1 the background for the odd dashes of
+ * LineDoubleDash.
+ */
+struct wide_line {
+	DrawablePtr drawable;
+	GCPtr gc;
+	struct sna_fill_spans *data;
+	uint32_t color;
+	bool solid;
+	bool ok;
+	int num[2];
+	xRectangle rect[2][256];
+};
+
+static void wide_line_flush(struct wide_line *w, int pen)
+{
+	struct sna_fill_spans *data = w->data;
+	bool ok;
+
+	if (w->num[pen] == 0)
+		return;
+
+	DBG(("%s: pen=%d, n=%d\n", __FUNCTION__, pen, w->num[pen]));
+
+	if (w->solid || pen)
+		ok = sna_poly_fill_rect_blt(w->drawable, data->bo, data->damage,
+					    w->gc, pen ? w->gc->bgPixel : w->color,
+					    w->num[pen], w->rect[pen],
+					    &data->region.extents,
+					    data->flags & 2);
+	else if (w->gc->fillStyle == FillTiled)
+		ok = sna_poly_fill_rect_tiled_blt(w->drawable,
+						  data->bo, data->damage,
+						  w->gc, w->num[pen], w->rect[pen],
+						  &data->region.extents,
+						  data->flags & 2);
+	else
+		ok = sna_poly_fill_rect_stippled_blt(w->drawable,
+						     data->bo, data->damage,
+						     w->gc, w->num[pen], w->rect[pen],
+						     &data->region.extents,
+						     data->flags & 2);
+	w->ok &= ok;
+	w->num[pen] = 0;
+}
+
+static void wide_line_box(struct wide_line *w, int pen,
+			  int x1, int y1, int x2, int y2)
+{
+	xRectangle *r;
+
+	/* Anything beyond the protocol limits is outside the drawable */
+	if (x1 < MINSHORT)
+		x1 = MINSHORT;
+	if (y1 < MINSHORT)
+		y1 = MINSHORT;
+	if (x2 > MAXSHORT)
+		x2 = MAXSHORT;
+	if (y2 > MAXSHORT)
+		y2 = MAXSHORT;
+	if (x2 <= x1 || y2 <= y1)
+		return;
+
+	if (w->num[pen] == ARRAY_SIZE(w->rect[pen]))
+		wide_line_flush(w, pen);
+
+	r = &w->rect[pen][w->num[pen]++];
+	r->x = x1;
+	r->y = y1;
+	r->width = x2 - x1;
+	r->height = y2 - y1;
+}
+
+/* As miWideSegment() for horizontal and vertical lines */
+static void wide_line_segment(struct wide_line *w, int pen,
+			      int x1, int y1, int x2, int y2,
+			      bool project_left, bool project_right)
+{
+	int lw = w->gc->lineWidth;
+
+	if (y2 < y1 || (y2 == y1 && x2 < x1)) {
+		bool project;
+		int t;
+
+		t = x1; x1 = x2; x2 = t;
+		t = y1; y1 = y2; y2 = t;
+		project = project_left;
+		project_left = project_right;
+		project_right = project;
+	}
+
+	if (y1 == y2) {
+		if (project_left)
+			x1 -= lw >> 1;
+		if (project_right)
+			x2 += (lw + 1) >> 1;
+		y1 -= lw >> 1;
+		wide_line_box(w, pen, x1, y1, x2, y1 + lw);
+	} else {
+		assert(x1 == x2);
+		if (project_left)
+			y1 -= lw >> 1;
+		if (project_right)
+			y2 += (lw + 1) >> 1;
+		x1 -= lw >> 1;
+		wide_line_box(w, pen, x1, y1, x1 + lw, y2);
+	}
+}
+
+/* A mitred right-angle join fills in the square about the corner */
+static void wide_line_join(struct wide_line *w, int x, int y)
+{
+	int lw = w->gc->lineWidth;
+
+	x -= lw >> 1;
+	y -= lw >> 1;
+	wide_line_box(w, 0, x, y, x + lw, y + lw);
+}
+
+/* Break a segment into its dashes, restarting the pattern at dashOffset */
+static void wide_line_dashes(struct wide_line *w,
+			     int x1, int y1, int x2, int y2)
+{
+	GCPtr gc = w->gc;
+	int dx, dy, len, pos, end;
+	unsigned dist, total;
+	int i;
+
+	total = 0;
+	for (i = 0; i < gc->numInDashList; i++)
+		total += gc->dash[i];
+	assert(total);
+
+	dist = gc->dashOffset % total;
+	for (i = 0; dist >= gc->dash[i]; i++)
+		dist -= gc->dash[i];
+
+	dx = x2 > x1 ? 1 : x2 < x1 ? -1 : 0;
+	dy = y2 > y1 ? 1 : y2 < y1 ? -1 : 0;
+	len = abs(x2 - x1) + abs(y2 - y1);
+
+	for (pos = 0; pos < len; pos = end) {
+		end = pos + gc->dash[i] - dist;
+		if (end > len)
+			end = len;
+
+		if ((i & 1) == 0 || gc->lineStyle == LineDoubleDash)
+			wide_line_segment(w, i & 1,
+					  x1 + dx*pos, y1 + dy*pos,
+					  x1 + dx*end, y1 + dy*end,
+					  false, false);
+
+		dist = 0;
+		if (++i == gc->numInDashList)
+			i = 0;
+	}
+}
+
+static bool wide_line_init(struct wide_line *w,
+			   DrawablePtr drawable, GCPtr gc,
+			   struct sna_fill_spans *data)
+{
+	if (!USE_WIDE_RECTS)
+		return false;
+
+	data->bo = sna_drawable_use_bo(drawable, PREFER_GPU,
+				       &data->region.extents,
+				       &data->damage);
+	if (data->bo == NULL)
+		return false;
+
+	w->drawable = drawable;
+	w->gc = gc;
+	w->data = data;
+	w->solid = gc_is_solid(gc, &w->color);
+	w->ok = true;
+	w->num[0] = w->num[1] = 0;
+	return true;
+}
+
+static bool wide_line_fini(struct wide_line *w)
+{
+	wide_line_flush(w, 0);
+	wide_line_flush(w, 1);
+	return w->ok;
+}
+
+/* Check that the polyline only turns through right-angles, as we
+ * cannot express a reversal or the lone dot of a degenerate line
+ * as rectangles.
+ */
+static bool
+wide_line_is_rectangular(int mode, int n, const DDXPointRec *pt,
+			 bool *self_join)
+{
+	int x1, y1, x2, y2, x, y;
+	int first = -1, last = -1;
+
+	x2 = pt->x;
+	y2 = pt->y;
+	x = x2;
+	y = y2;
+	while (--n) {
+		int dir;
+
+		x1 = x2;
+		y1 = y2;
+		pt++;
+		x2 = pt->x;
+		y2 = pt->y;
+		if (mode == CoordModePrevious) {
+			x2 += x1;
+			y2 += y1;
+		}
+		if (x1 == x2 && y1 == y2)
+			continue;
+
+		/* 0: right, 1: down, 2: left, 3: up */
+		if (y1 == y2)
+			dir = x2 > x1 ? 0 : 2;
+		else
+			dir = y2 > y1 ? 1 : 3;
+
+		if (last != -1 && (dir ^ last) == 2)
+			return false;
+
+		if (first == -1)
+			first = dir;
+		last = dir;
+	}
+
+	if (first == -1)
+		return false;
+
+	*self_join = x2 == x && y2 == y;
+	if (*self_join && (first ^ last) == 2)
+		return false;
+
+	return true;
+}
+
+/* As miWideLine() for a mitred, rectilinear polyline */
+static void wide_line_poly(struct wide_line *w,
+			   int mode, int n, const DDXPointRec *pt,
+			   bool self_join)
+{
+	GCPtr gc = w->gc;
+	int x1, y1, x2, y2;
+	int x0 = 0, y0 = 0;
+	bool project_left, project_right = false, drawn = false;
+	bool horizontal = false, first_horizontal = false;
+
+	project_left = gc->capStyle == CapProjecting && !self_join;
+
+	x2 = pt->x;
+	y2 = pt->y;
+	while (--n) {
+		x1 = x2;
+		y1 = y2;
+		pt++;
+		x2 = pt->x;
+		y2 = pt->y;
+		if (mode == CoordModePrevious) {
+			x2 += x1;
+			y2 += y1;
+		}
+		if (x1 == x2 && y1 == y2)
+			continue;
+
+		if (n == 1 && gc->capStyle == CapProjecting && !self_join)
+			project_right = true;
+
+		if (drawn) {
+			if (horizontal != (y1 == y2))
+				wide_line_join(w, x1, y1);
+		} else {
+			first_horizontal = y1 == y2;
+			x0 = x1;
+			y0 = y1;
+		}
+		horizontal = y1 == y2;
+
+		wide_line_segment(w, 0, x1, y1, x2, y2,
+				  project_left, project_right);
+		project_left = false;
+		drawn = true;
+	}
+
+	if (self_join && horizontal != first_horizontal)
+		wide_line_join(w, x0, y0);
+}
+
+static bool
+sna_poly_wide_line_blt(DrawablePtr drawable, GCPtr gc,
+		       struct sna_fill_spans *data,
+		       int mode, int n, DDXPointPtr pt)
+{
+	struct wide_line w;
+	bool self_join;
+
+	DBG(("%s: n=%d, width=%d, cap=%d, join=%d, alu=%d\n",
+	     __FUNCTION__, n, gc->lineWidth,
+	     gc->capStyle, gc->joinStyle, gc->alu));
+
+	if (gc->lineStyle != LineSolid || gc->capStyle == CapRound)
+		return false;
+
+	if (!wide_line_is_rectangular(mode, n, pt, &self_join))
+		return false;
+
+	/* With more than one segment the joins overlap, which we can
+	 * only tolerate if repainting a pixel leaves it unchanged
+	 * (mi would accumulate the spans and paint them just once).
+	 */
+	if (n > 2 &&
+	    (gc->joinStyle != JoinMiter || !alu_overwrites(gc->alu)))
+		return false;
+
+	if (!wide_line_init(&w, drawable, gc, data))
+		return false;
+
+	wide_line_poly(&w, mode, n, pt, self_join);
+	return wide_line_fini(&w);
+}
+
+static bool
+sna_poly_wide_segment_blt(DrawablePtr drawable, GCPtr gc,
+			  struct sna_fill_spans *data,
+			  int n, xSegment *seg)
+{
+	struct wide_line w;
+	int i;
+
+	DBG(("%s: n=%d, width=%d, style=%d, cap=%d, alu=%d\n",
+	     __FUNCTION__, n, gc->lineWidth,
+	     gc->lineStyle, gc->capStyle, gc->alu));
+
+	if (gc->capStyle == CapRound)
+		return false;
+
+	if (gc->lineStyle != LineSolid) {
+		/* Projecting caps on each dash would overlap */
+		if (gc->capStyle == CapProjecting)
+			return false;
+
+		if (gc->lineStyle == LineDoubleDash &&
+		    gc->fillStyle != FillSolid)
+			return false;
+	}
+
+	for (i = 0; i < n; i++)
+		if (seg[i].x1 == seg[i].x2 && seg[i].y1 == seg[i].y2)
+			return false;
+
+	if (!wide_line_init(&w, drawable, gc, data))
+		return false;
+
+	for (i = 0; i < n; i++) {
+		if (gc->lineStyle == LineSolid) {
+			bool project = gc->capStyle == CapProjecting;
+			wide_line_segment(&w, 0,
+					  seg[i].x1, seg[i].y1,
+					  seg[i].x2, seg[i].y2,
+					  project, project);
+		} else {
+			wide_line_dashes(&w,
+					 seg[i].x1, seg[i].y1,
+					 seg[i].x2, seg[i].y2);
+			/* Keep the fg/bg dashes of each segment in order */
+			if (gc->lineStyle == LineDoubleDash) {
+				wide_line_flush(&w, 0);
+				wide_line_flush(&w, 1);
+			}
+		}
+	}
+
+	return wide_line_fini(&w);
+}
+
 static void
 sna_poly_line(DrawablePtr drawable, GCPtr gc,
 	      int mode, int n, DDXPointPtr pt)
@@ -7504,6 +8158,7 @@ sna_poly_line(DrawablePtr drawable, GCPtr gc,
 	data.sna = to_sna_from_pixmap(data.pixmap);
 	if (wedged(data.sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
@@ -7515,16 +8170,23 @@ sna_poly_line(DrawablePtr drawable, GCPtr gc,
 	     gc->planemask, PM_IS_SOLID(drawable, gc->planemask),
 	     data.flags & 4));
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(data.sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	priv = sna_pixmap(data.pixmap);
 	if (!priv) {
 		DBG(("%s: not attached to pixmap %ld\n",
 		     __FUNCTION__, data.pixmap->drawable.serialNumber));
+		sna_fallback_reason(data.sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
+	if (gc->lineWidth > 1 && data.flags & 4 &&
+	    sna_poly_wide_line_blt(drawable, gc, &data, mode, n, pt))
+		return;
+
 	if (gc->lineStyle != LineSolid) {
 		DBG(("%s: lineStyle, %d, is not solid\n",
 		     __FUNCTION__, gc->lineStyle));
@@ -7764,12 +8426,16 @@ spans_fallback:
 		return;
 	}
 
+	sna_fallback_reason(data.sna, line_fallback_reason(gc));
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
 	region_maybe_clip(&data.region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&data.region))
+	if (!RegionNotEmpty(&data.region)) {
+		sna_fallback_clear(data.sna);
 		return;
+	}
 
+	sna_fallback_record(data.sna, &data.region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &data.region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &data.region,
@@ -8409,11 +9075,13 @@ sna_poly_segment(DrawablePtr drawable, GCPtr gc, int n, xSegment *seg)
 	priv = sna_pixmap(data.pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
 	if (wedged(data.sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
@@ -8424,8 +9092,14 @@ sna_poly_segment(DrawablePtr drawable, GCPtr gc, int n, xSegment *seg)
 	     gc->lineWidth,
 	     gc->planemask, PM_IS_SOLID(drawable, gc->planemask),
 	     data.flags & 4));
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(data.sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
+
+	if (gc->lineWidth > 1 && data.flags & 4 &&
+	    sna_poly_wide_segment_blt(drawable, gc, &data, n, seg))
+		return;
 
 	if (gc->lineStyle != LineSolid || gc->lineWidth > 1)
 		goto spans_fallback;
@@ -8463,8 +9137,10 @@ sna_poly_segment(DrawablePtr drawable, GCPtr gc, int n, xSegment *seg)
 		data.bo = sna_drawable_use_bo(drawable, PREFER_GPU,
 					      &data.region.extents,
 					      &data.damage);
-		if (data.bo == NULL)
+		if (data.bo == NULL) {
+			sna_fallback_reason(data.sna, FALLBACK_CPU);
 			goto fallback;
+		}
 
 		DBG(("%s: converting to rectagnles\n", __FUNCTION__));
 
@@ -8608,12 +9284,16 @@ spans_fallback:
 		return;
 	}
 
+	sna_fallback_reason(data.sna, line_fallback_reason(gc));
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
 	region_maybe_clip(&data.region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&data.region))
+	if (!RegionNotEmpty(&data.region)) {
+		sna_fallback_clear(data.sna);
 		return;
+	}
 
+	sna_fallback_record(data.sna, &data.region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &data.region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &data.region,
@@ -9177,6 +9857,7 @@ sna_poly_rectangle(DrawablePtr drawable, GCPtr gc, int n, xRectangle *r)
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
@@ -9186,8 +9867,10 @@ sna_poly_rectangle(DrawablePtr drawable, GCPtr gc, int n, xRectangle *r)
 	     gc->joinStyle, gc->joinStyle == JoinMiter,
 	     gc->planemask, PM_IS_SOLID(drawable, gc->planemask)));
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if (gc->lineStyle == LineSolid && gc->joinStyle == JoinMiter) {
 		DBG(("%s: trying blt solid fill [%08lx] paths\n",
@@ -9213,9 +9896,12 @@ fallback:
 
 	region.data = NULL;
 	region_maybe_clip(&region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&region))
+	if (!RegionNotEmpty(&region)) {
+		sna_fallback_clear(sna);
 		return;
+	}
 
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -9312,16 +9998,20 @@ sna_poly_arc(DrawablePtr drawable, GCPtr gc, int n, xArc *arc)
 	priv = sna_pixmap(data.pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
 	if (wedged(data.sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(data.sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if ((data.bo = sna_drawable_use_bo(drawable,
 					   use_wide_spans(drawable, gc, &data.region.extents),
@@ -9409,12 +10099,16 @@ sna_poly_arc(DrawablePtr drawable, GCPtr gc, int n, xArc *arc)
 		return;
 	}
 
+	sna_fallback_reason(data.sna, line_fallback_reason(gc));
 fallback:
 	DBG(("%s -- fallback\n", __FUNCTION__));
 	region_maybe_clip(&data.region, gc->pCompositeClip);
-	if (!RegionNotEmpty(&data.region))
+	if (!RegionNotEmpty(&data.region)) {
+		sna_fallback_clear(data.sna);
 		return;
+	}
 
+	sna_fallback_record(data.sna, &data.region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &data.region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &data.region,
@@ -9688,16 +10382,20 @@ sna_poly_fill_polygon(DrawablePtr draw, GCPtr gc,
 	priv = sna_pixmap(data.pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
 	if (wedged(data.sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
-	if (!PM_IS_SOLID(draw, gc->planemask))
+	if (!PM_IS_SOLID(draw, gc->planemask)) {
+		sna_fallback_reason(data.sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if ((data.bo = sna_drawable_use_bo(draw,
 					   (shape == Convex ? use_zero_spans : use_wide_spans)(draw, gc, &data.region.extents),
@@ -9758,6 +10456,7 @@ sna_poly_fill_polygon(DrawablePtr draw, GCPtr gc,
 		return;
 	}
 
+	sna_fallback_reason(data.sna, FALLBACK_CPU);
 fallback:
 	DBG(("%s: fallback (%d, %d), (%d, %d)\n", __FUNCTION__,
 	     data.region.extents.x1, data.region.extents.y1,
@@ -9765,9 +10464,11 @@ fallback:
 	region_maybe_clip(&data.region, gc->pCompositeClip);
 	if (!RegionNotEmpty(&data.region)) {
 		DBG(("%s: nothing to do, all clipped\n", __FUNCTION__));
+		sna_fallback_clear(data.sna);
 		return;
 	}
 
+	sna_fallback_record(data.sna, &data.region.extents);
 	if (!sna_gc_move_to_cpu(gc, draw, &data.region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(draw, &data.region,
@@ -10121,20 +10822,96 @@ done:
 	return true;
 }
 
-static bool
-sna_poly_fill_rect_tiled_nxm_blt(DrawablePtr drawable,
-				 struct kgem_bo *bo,
-				 struct sna_damage **damage,
-				 GCPtr gc, int n, const xRectangle *rect,
-				 const BoxRec *extents, unsigned clipped)
+static uint32_t pattern_checksum(const uint32_t *data, int len)
 {
-	PixmapPtr pixmap = get_drawable_pixmap(drawable);
-	struct sna *sna = to_sna_from_pixmap(pixmap);
-	PixmapPtr tile = gc->tile.pixmap;
-	struct kgem_bo *upload;
-	int w, h, cpp;
-	void *ptr;
-	bool ret;
+	uint32_t csum = 0;
+
+	while (len--) {
+		csum = csum << 5 | csum >> 27;
+		csum ^= *data++;
+	}
+
+	return csum;
+}
+
+/* Legacy toolkits fill with only a handful of small tiles, so rather
+ * than upload the expanded 8x8 pattern every time, keep the last few
+ * around and share them between all GCs. The tile pixmap may be
+ * modified at any time, so look the pattern up by its contents.
+ */
+static struct kgem_bo *
+sna_pattern_cache_get(struct sna *sna, const uint32_t *data, int bpp)
+{
+	struct sna_pattern_cache *cache = &sna->patterns;
+	struct sna_pattern *p;
+	struct kgem_bo *bo;
+	int len = 8 * 8 * bpp / 8;
+	uint32_t checksum;
+	int i;
+
+	checksum = pattern_checksum(data, len / 4);
+	for (i = 0; i < ARRAY_SIZE(cache->entry); i++) {
+		p = &cache->entry[i];
+		if (p->bo && p->checksum == checksum && p->bpp == bpp &&
+		    memcmp(p->data, data, len) == 0) {
+			DBG(("%s: hit handle=%d, checksum=%08x\n",
+			     __FUNCTION__, p->bo->handle, checksum));
+			cache->hits++;
+			return kgem_bo_reference(p->bo);
+		}
+	}
+
+	DBG(("%s: miss, checksum=%08x\n", __FUNCTION__, checksum));
+	cache->misses++;
+
+	bo = kgem_create_linear(&sna->kgem, len, 0);
+	if (bo == NULL)
+		return NULL;
+
+	if (!kgem_bo_write(&sna->kgem, bo, data, len)) {
+		kgem_bo_destroy(&sna->kgem, bo);
+		return NULL;
+	}
+
+	p = &cache->entry[cache->next++ % ARRAY_SIZE(cache->entry)];
+	if (p->bo)
+		kgem_bo_destroy(&sna->kgem, p->bo);
+	p->bo = bo;
+	p->checksum = checksum;
+	p->bpp = bpp;
+	memcpy(p->data, data, len);
+
+	return kgem_bo_reference(bo);
+}
+
+static void sna_pattern_cache_fini(struct sna *sna)
+{
+	struct sna_pattern_cache *cache = &sna->patterns;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache->entry); i++) {
+		if (cache->entry[i].bo) {
+			kgem_bo_destroy(&sna->kgem, cache->entry[i].bo);
+			cache->entry[i].bo = NULL;
+		}
+	}
+}
+
+static bool
+sna_poly_fill_rect_tiled_nxm_blt(DrawablePtr drawable,
+				 struct kgem_bo *bo,
+				 struct sna_damage **damage,
+				 GCPtr gc, int n, const xRectangle *rect,
+				 const BoxRec *extents, unsigned clipped)
+{
+	PixmapPtr pixmap = get_drawable_pixmap(drawable);
+	struct sna *sna = to_sna_from_pixmap(pixmap);
+	PixmapPtr tile = gc->tile.pixmap;
+	struct kgem_bo *tile_bo;
+	uint32_t pattern[8*8];
+	uint8_t *ptr = (uint8_t *)pattern;
+	int w, h, cpp;
+	bool ret;
 
 	DBG(("%s: %dx%d\n", __FUNCTION__,
 	     tile->drawable.width, tile->drawable.height));
@@ -10142,19 +10919,13 @@ sna_poly_fill_rect_tiled_nxm_blt(DrawablePtr drawable,
 	if (!sna_pixmap_move_to_cpu(tile, MOVE_READ))
 		return false;
 
-	upload = kgem_create_buffer(&sna->kgem, 8*tile->drawable.bitsPerPixel,
-				    KGEM_BUFFER_WRITE_INPLACE,
-				    &ptr);
-	if (upload == NULL)
-		return false;
-
 	assert(tile->drawable.height && tile->drawable.height <= 8);
 	assert(tile->drawable.width && tile->drawable.width <= 8);
 
 	cpp = tile->drawable.bitsPerPixel/8;
 	for (h = 0; h < tile->drawable.height; h++) {
 		uint8_t *src = (uint8_t *)tile->devPrivate.ptr + tile->devKind*h;
-		uint8_t *dst = (uint8_t *)ptr + 8*cpp*h;
+		uint8_t *dst = ptr + 8*cpp*h;
 
 		w = tile->drawable.width*cpp;
 		memcpy(dst, src, w);
@@ -10164,15 +10935,20 @@ sna_poly_fill_rect_tiled_nxm_blt(DrawablePtr drawable,
 		}
 	}
 	while (h < 8) {
-		memcpy((uint8_t*)ptr + h*w, ptr, h*w);
+		memcpy(ptr + h*w, ptr, h*w);
 		h *= 2;
 	}
 
+	tile_bo = sna_pattern_cache_get(sna, pattern,
+					tile->drawable.bitsPerPixel);
+	if (tile_bo == NULL)
+		return false;
+
 	ret = sna_poly_fill_rect_tiled_8x8_blt(drawable, bo, damage,
-					       upload, gc, n, rect,
+					       tile_bo, gc, n, rect,
 					       extents, clipped);
 
-	kgem_bo_destroy(&sna->kgem, upload);
+	kgem_bo_destroy(&sna->kgem, tile_bo);
 	return ret;
 }
 
@@ -10212,7 +10988,11 @@ sna_poly_fill_rect_tiled_blt(DrawablePtr drawable,
 	 * RENDER.
 	 */
 
-	if ((tile->drawable.width | tile->drawable.height) == 8) {
+	/* Only use the GPU copy of an 8x8 tile if it was rendered there,
+	 * otherwise fetch the expanded pattern from the cache.
+	 */
+	if ((tile->drawable.width | tile->drawable.height) == 8 &&
+	    sna_pixmap(tile) && sna_pixmap(tile)->gpu_damage) {
 		bool ret;
 
 		tile_bo = sna_pixmap_get_source_bo(tile);
@@ -11887,17 +12667,20 @@ sna_poly_fill_rect(DrawablePtr draw, GCPtr gc, int n, xRectangle *rect)
 
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	if (!PM_IS_SOLID(draw, gc->planemask)) {
 		DBG(("%s: fallback -- planemask=%#lx (not-solid)\n",
 		     __FUNCTION__, gc->planemask));
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
 	}
 
@@ -11948,6 +12731,7 @@ sna_poly_fill_rect(DrawablePtr draw, GCPtr gc, int n, xRectangle *rect)
 	bo = sna_drawable_use_bo(draw, hint, &region.extents, &damage);
 	if (bo == NULL) {
 		DBG(("%s: not using GPU, hint=%x\n", __FUNCTION__, hint));
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
 	}
 
@@ -11984,9 +12768,11 @@ fallback:
 	region_maybe_clip(&region, gc->pCompositeClip);
 	if (!RegionNotEmpty(&region)) {
 		DBG(("%s: nothing to do, all clipped\n", __FUNCTION__));
+		sna_fallback_clear(sna);
 		return;
 	}
 
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, draw, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(draw, &region,
@@ -12002,6 +12788,151 @@ out:
 	RegionUninit(&region);
 }
 
+/* Complete ellipses are by far the most common filled arcs (the
+ * markers in charts and plots). Rather than have miPolyFillArc()
+ * allocate and submit the spans for each arc in turn, we scan convert
+ * them here, as miFillEllipseI(), and pass the spans for many arcs to
+ * FillSpans at once. Everything else is left to mi, one arc at a time
+ * to preserve the drawing order.
+ */
+#define FULL_CIRCLE (360 * 64)
+
+struct arc_spans {
+	DrawablePtr drawable;
+	GCPtr gc;
+	int n;
+	DDXPointRec pt[512];
+	int width[512];
+};
+
+static void arc_spans_flush(struct arc_spans *s)
+{
+	if (s->n) {
+		s->gc->ops->FillSpans(s->drawable, s->gc,
+				      s->n, s->pt, s->width, false);
+		s->n = 0;
+	}
+}
+
+static inline void arc_spans_add(struct arc_spans *s, int x, int y, int w)
+{
+	if (s->n == ARRAY_SIZE(s->pt))
+		arc_spans_flush(s);
+
+	s->pt[s->n].x = x;
+	s->pt[s->n].y = y;
+	s->width[s->n] = w;
+	s->n++;
+}
+
+static inline bool arc_is_empty(const xArc *arc)
+{
+	return (arc->angle2 == 0 ||
+		arc->width == 0 || arc->height == 0 ||
+		(arc->width == 1 && arc->height & 1));
+}
+
+static inline bool arc_is_ellipse(const xArc *arc)
+{
+	if (arc->angle2 < FULL_CIRCLE && arc->angle2 > -FULL_CIRCLE)
+		return false;
+
+	/* Beyond this the integer error terms overflow */
+	return (arc->width == arc->height ||
+		(arc->width <= 800 && arc->height <= 800));
+}
+
+/* See miFillArcSetup() and MIFILLARCSTEP() */
+static void arc_spans_ellipse(struct arc_spans *s, const xArc *arc)
+{
+	int x, y, e, xk, xm, yk, ym, dx, dy, xorg, yorg;
+
+	y = arc->height >> 1;
+	dy = arc->height & 1;
+	yorg = arc->y + y;
+	dx = arc->width & 1;
+	xorg = arc->x + (arc->width >> 1) + dx;
+	dx = 1 - dx;
+	if (arc->width == arc->height) {
+		ym = 8;
+		xm = 8;
+		yk = y << 3;
+		if (!dx) {
+			xk = 0;
+			e = -1;
+		} else {
+			y++;
+			yk += 4;
+			xk = -4;
+			e = -(y << 3);
+		}
+	} else {
+		ym = (arc->width * arc->width) << 3;
+		xm = (arc->height * arc->height) << 3;
+		yk = y * ym;
+		if (!dy)
+			yk -= ym >> 1;
+		if (!dx) {
+			xk = 0;
+			e = -(xm >> 3);
+		} else {
+			y++;
+			yk += ym;
+			xk = -(xm >> 1);
+			e = xk - yk;
+		}
+	}
+
+	xorg += s->drawable->x;
+	yorg += s->drawable->y;
+
+	x = 0;
+	while (y > 0) {
+		int slw;
+
+		e += yk;
+		while (e >= 0) {
+			x++;
+			xk -= xm;
+			e += xk;
+		}
+		y--;
+		yk -= ym;
+		slw = (x << 1) + dx;
+		if (e == xk && slw > 1)
+			slw--;
+
+		arc_spans_add(s, xorg - x, yorg - y, slw);
+		if (y + dy != 0 && (slw > 1 || e != xk))
+			arc_spans_add(s, xorg - x, yorg + y + dy, slw);
+	}
+}
+
+static void
+sna_poly_fill_arc__spans(DrawablePtr drawable, GCPtr gc, int n, xArc *arc)
+{
+	struct arc_spans s;
+
+	assert(gc->miTranslate);
+
+	s.drawable = drawable;
+	s.gc = gc;
+	s.n = 0;
+
+	for (; n--; arc++) {
+		if (arc_is_empty(arc))
+			continue;
+
+		if (arc_is_ellipse(arc)) {
+			arc_spans_ellipse(&s, arc);
+		} else {
+			arc_spans_flush(&s);
+			miPolyFillArc(drawable, gc, 1, arc);
+		}
+	}
+	arc_spans_flush(&s);
+}
+
 static void
 sna_poly_fill_arc(DrawablePtr draw, GCPtr gc, int n, xArc *arc)
 {
@@ -12038,16 +12969,20 @@ sna_poly_fill_arc(DrawablePtr draw, GCPtr gc, int n, xArc *arc)
 	priv = sna_pixmap(data.pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- unattached\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
 	if (wedged(data.sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(data.sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
-	if (!PM_IS_SOLID(draw, gc->planemask))
+	if (!PM_IS_SOLID(draw, gc->planemask)) {
+		sna_fallback_reason(data.sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if ((data.bo = sna_drawable_use_bo(draw, PREFER_GPU,
 					   &data.region.extents,
@@ -12086,13 +13021,13 @@ sna_poly_fill_arc(DrawablePtr draw, GCPtr gc, int n, xArc *arc)
 			assert(gc->miTranslate);
 			gc->ops = &sna_gc_ops__tmp;
 
-			miPolyFillArc(draw, gc, n, arc);
+			sna_poly_fill_arc__spans(draw, gc, n, arc);
 			fill.done(data.sna, &fill);
 		} else {
 			sna_gc_ops__tmp.FillSpans = sna_fill_spans__gpu;
 			gc->ops = &sna_gc_ops__tmp;
 
-			miPolyFillArc(draw, gc, n, arc);
+			sna_poly_fill_arc__spans(draw, gc, n, arc);
 		}
 
 		gc->ops = (GCOps *)&sna_gc_ops;
@@ -12107,6 +13042,7 @@ sna_poly_fill_arc(DrawablePtr draw, GCPtr gc, int n, xArc *arc)
 		return;
 	}
 
+	sna_fallback_reason(data.sna, FALLBACK_CPU);
 fallback:
 	DBG(("%s: fallback (%d, %d), (%d, %d)\n", __FUNCTION__,
 	     data.region.extents.x1, data.region.extents.y1,
@@ -12114,9 +13050,11 @@ fallback:
 	region_maybe_clip(&data.region, gc->pCompositeClip);
 	if (!RegionNotEmpty(&data.region)) {
 		DBG(("%s: nothing to do, all clipped\n", __FUNCTION__));
+		sna_fallback_clear(data.sna);
 		return;
 	}
 
+	sna_fallback_record(data.sna, &data.region.extents);
 	if (!sna_gc_move_to_cpu(gc, draw, &data.region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(draw, &data.region,
@@ -12576,14 +13514,20 @@ sna_poly_text8(DrawablePtr drawable, GCPtr gc,
 	if (!ACCEL_POLY_TEXT8)
 		goto fallback;
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FONT);
 		goto fallback;
+	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
-	if (!gc_is_solid(gc, &fg))
+	if (!gc_is_solid(gc, &fg)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FILL);
 		goto fallback;
+	}
 
 	if (!sna_glyph_blt(drawable, gc, x, y, n, info, &region, fg, -1, true)) {
 fallback:
@@ -12591,6 +13535,7 @@ fallback:
 		gc->font->get_glyphs(gc->font, count, (unsigned char *)chars,
 				     Linear8Bit, &n, info);
 
+		sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 		if (!sna_gc_move_to_cpu(gc, drawable, &region))
 			goto out;
 		if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -12650,14 +13595,20 @@ sna_poly_text16(DrawablePtr drawable, GCPtr gc,
 	if (!ACCEL_POLY_TEXT16)
 		goto fallback;
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FONT);
 		goto fallback;
+	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
-	if (!gc_is_solid(gc, &fg))
+	if (!gc_is_solid(gc, &fg)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FILL);
 		goto fallback;
+	}
 
 	if (!sna_glyph_blt(drawable, gc, x, y, n, info, &region, fg, -1, true)) {
 fallback:
@@ -12666,6 +13617,7 @@ fallback:
 				     FONTLASTROW(gc->font) ? TwoD16Bit : Linear16Bit,
 				     &n, info);
 
+		sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 		if (!sna_gc_move_to_cpu(gc, drawable, &region))
 			goto out;
 		if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -12736,11 +13688,15 @@ sna_image_text8(DrawablePtr drawable, GCPtr gc,
 	if (!ACCEL_IMAGE_TEXT8)
 		goto fallback;
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FONT);
 		goto fallback;
+	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if (!sna_glyph_blt(drawable, gc, x, y, n, info, &region,
 			   gc->fgPixel, gc->bgPixel, false)) {
@@ -12749,6 +13705,7 @@ fallback:
 		gc->font->get_glyphs(gc->font, count, (unsigned char *)chars,
 				     Linear8Bit, &n, info);
 
+		sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 		if (!sna_gc_move_to_cpu(gc, drawable, &region))
 			goto out;
 		if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -12818,11 +13775,15 @@ sna_image_text16(DrawablePtr drawable, GCPtr gc,
 	if (!ACCEL_IMAGE_TEXT16)
 		goto fallback;
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_FONT);
 		goto fallback;
+	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(to_sna_from_drawable(drawable), FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
 	if (!sna_glyph_blt(drawable, gc, x, y, n, info, &region,
 			   gc->fgPixel, gc->bgPixel, false)) {
@@ -12832,6 +13793,7 @@ fallback:
 				     FONTLASTROW(gc->font) ? TwoD16Bit : Linear16Bit,
 				     &n, info);
 
+		sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 		if (!sna_gc_move_to_cpu(gc, drawable, &region))
 			goto out;
 		if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -13115,14 +14077,19 @@ sna_image_glyph(DrawablePtr drawable, GCPtr gc,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(sna, FALLBACK_FONT);
 		goto fallback;
+	}
 
 	if ((bo = sna_drawable_use_bo(drawable, PREFER_GPU,
 				      &region.extents, &damage)) &&
@@ -13133,6 +14100,7 @@ sna_image_glyph(DrawablePtr drawable, GCPtr gc,
 
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -13193,17 +14161,24 @@ sna_poly_glyph(DrawablePtr drawable, GCPtr gc,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
-	if (!PM_IS_SOLID(drawable, gc->planemask))
+	if (!PM_IS_SOLID(drawable, gc->planemask)) {
+		sna_fallback_reason(sna, FALLBACK_PLANEMASK);
 		goto fallback;
+	}
 
-	if (!gc_is_solid(gc, &fg))
+	if (!gc_is_solid(gc, &fg)) {
+		sna_fallback_reason(sna, FALLBACK_FILL);
 		goto fallback;
+	}
 
-	if (sna_font_too_large(gc->font))
+	if (sna_font_too_large(gc->font)) {
+		sna_fallback_reason(sna, FALLBACK_FONT);
 		goto fallback;
+	}
 
 	if ((bo = sna_drawable_use_bo(drawable, PREFER_GPU,
 				      &region.extents, &damage)) &&
@@ -13213,6 +14188,7 @@ sna_poly_glyph(DrawablePtr drawable, GCPtr gc,
 
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_drawable_move_region_to_cpu(drawable, &region,
@@ -13394,6 +14370,7 @@ sna_push_pixels(GCPtr gc, PixmapPtr bitmap, DrawablePtr drawable,
 	}
 
 	DBG(("%s: fallback\n", __FUNCTION__));
+	sna_fallback_record(to_sna_from_drawable(drawable), &region.extents);
 	if (!sna_gc_move_to_cpu(gc, drawable, &region))
 		goto out;
 	if (!sna_pixmap_move_to_cpu(bitmap, MOVE_READ))
@@ -13412,147 +14389,735 @@ out:
 	RegionUninit(&region);
 }
 
-static const GCOps sna_gc_ops = {
-	sna_fill_spans,
-	sna_set_spans,
-	sna_put_image,
-	sna_copy_area,
-	sna_copy_plane,
-	sna_poly_point,
-	sna_poly_line,
-	sna_poly_segment,
-	sna_poly_rectangle,
-	sna_poly_arc,
-	sna_poly_fill_polygon,
-	sna_poly_fill_rect,
-	sna_poly_fill_arc,
-	sna_poly_text8,
-	sna_poly_text16,
-	sna_image_text8,
-	sna_image_text16,
-	sna_image_glyph,
-	sna_poly_glyph,
-	sna_push_pixels,
-};
-
-static const GCOps sna_gc_ops__cpu = {
-	fbFillSpans,
-	fbSetSpans,
-	fbPutImage,
-	fbCopyArea,
-	fbCopyPlane,
-	sna_poly_point__cpu,
-	fbPolyLine,
-	fbPolySegment,
-	miPolyRectangle,
-	fbPolyArc,
-	miFillPolygon,
-	fbPolyFillRect,
-	miPolyFillArc,
-	miPolyText8,
-	miPolyText16,
-	miImageText8,
-	miImageText16,
-	fbImageGlyphBlt,
-	fbPolyGlyphBlt,
-	fbPushPixels
-};
+/* Request profiling, see sna_profile.h. The pixel counts are only
+ * estimates, usually of the area covered by the primitives, and are
+ * only computed whilst profiling is enabled. They are taken before the
+ * call, which may rewrite its arguments in place, and outside of the
+ * timed section.
+ */
+#define PROFILE(sna, op, pixels, call) do {				\
+	struct sna_profile_sample sample__;				\
+	uint64_t pixels__;						\
+	if (((sna)->flags & SNA_PROFILE) == 0) {			\
+		call;							\
+		break;							\
+	}								\
+	pixels__ = (pixels);						\
+	sna_profile_begin(&(sna)->profile, &sample__);			\
+	call;								\
+	sna_profile_end(&(sna)->profile, &sample__, op, pixels__);	\
+} while (0)
+
+static uint64_t profile_spans(int n, const int *width)
+{
+	uint64_t pixels = 0;
 
-static GCOps sna_gc_ops__tmp = {
-	sna_fill_spans,
-	sna_set_spans,
-	sna_put_image,
-	sna_copy_area,
-	sna_copy_plane,
-	sna_poly_point,
-	sna_poly_line,
-	sna_poly_segment,
-	sna_poly_rectangle,
-	sna_poly_arc,
-	sna_poly_fill_polygon,
-	sna_poly_fill_rect,
-	sna_poly_fill_arc,
-	sna_poly_text8,
-	sna_poly_text16,
-	sna_image_text8,
-	sna_image_text16,
-	sna_image_glyph,
-	sna_poly_glyph,
-	sna_push_pixels,
-};
+	while (n--)
+		pixels += *width++;
+	return pixels;
+}
 
-static void
-sna_validate_gc(GCPtr gc, unsigned long changes, DrawablePtr drawable)
+static uint64_t profile_rects(int n, const xRectangle *r)
 {
-	DBG(("%s changes=%lx\n", __FUNCTION__, changes));
+	uint64_t pixels = 0;
 
-	if (changes & (GCClipMask|GCSubwindowMode) ||
-	    drawable->serialNumber != (gc->serialNumber & DRAWABLE_SERIAL_BITS) ||
-	    (gc->clientClipType != CT_NONE && (changes & (GCClipXOrigin | GCClipYOrigin))))
-		miComputeCompositeClip(gc, drawable);
+	for (; n--; r++)
+		pixels += (uint64_t)r->width * r->height;
+	return pixels;
+}
 
-	sna_gc(gc)->changes |= changes;
+static uint64_t profile_rect_outlines(int n, const xRectangle *r)
+{
+	uint64_t pixels = 0;
+
+	for (; n--; r++)
+		pixels += 2 * (r->width + r->height);
+	return pixels;
 }
 
-static const GCFuncs sna_gc_funcs = {
-	sna_validate_gc,
-	miChangeGC,
-	miCopyGC,
-	miDestroyGC,
-	miChangeClip,
-	miDestroyClip,
-	miCopyClip
-};
+static uint64_t profile_arcs(int n, const xArc *arc, bool fill)
+{
+	uint64_t pixels = 0;
 
-static const GCFuncs sna_gc_funcs__cpu = {
-	fbValidateGC,
-	miChangeGC,
-	miCopyGC,
-	miDestroyGC,
-	miChangeClip,
-	miDestroyClip,
-	miCopyClip
-};
+	for (; n--; arc++) {
+		if (fill)
+			pixels += (uint64_t)arc->width * arc->height;
+		else
+			pixels += 2 * (arc->width + arc->height);
+	}
+	return pixels;
+}
 
-static int sna_create_gc(GCPtr gc)
+static uint64_t profile_line(int mode, int n, const DDXPointRec *pt)
 {
-	gc->miTranslate = 1;
-	gc->fExpose = 1;
+	uint64_t pixels = n;
+	int i;
 
-	fb_gc(gc)->bpp = bits_per_pixel(gc->depth);
+	for (i = 1; i < n; i++) {
+		int dx = pt[i].x, dy = pt[i].y;
 
-	gc->funcs = (GCFuncs *)&sna_gc_funcs;
-	gc->ops = (GCOps *)&sna_gc_ops;
-	return true;
+		if (mode == CoordModeOrigin) {
+			dx -= pt[i-1].x;
+			dy -= pt[i-1].y;
+		}
+		pixels += MAX(abs(dx), abs(dy));
+	}
+	return pixels;
 }
 
-static void
-sna_get_image(DrawablePtr drawable,
-	      int x, int y, int w, int h,
-	      unsigned int format, unsigned long mask,
-	      char *dst)
+static uint64_t profile_segments(int n, const xSegment *seg)
 {
-	RegionRec region;
-	unsigned int flags;
+	uint64_t pixels = 0;
 
-	if (!fbDrawableEnabled(drawable))
-		return;
+	for (; n--; seg++)
+		pixels += 1 + MAX(abs(seg->x2 - seg->x1), abs(seg->y2 - seg->y1));
+	return pixels;
+}
 
-	DBG(("%s (%d, %d)x(%d, %d)\n", __FUNCTION__, x, y, w, h));
+static uint64_t profile_polygon(int mode, int n, const DDXPointRec *pt)
+{
+	int x, y, x1, y1, x2, y2, i;
 
-	region.extents.x1 = x + drawable->x;
-	region.extents.y1 = y + drawable->y;
-	region.extents.x2 = region.extents.x1 + w;
-	region.extents.y2 = region.extents.y1 + h;
-	region.data = NULL;
+	if (n == 0)
+		return 0;
 
-	flags = MOVE_READ;
-	if ((w | h) == 1)
-		flags |= MOVE_INPLACE_HINT;
-	if (w == drawable->width)
-		flags |= MOVE_WHOLE_HINT;
-	if (!sna_drawable_move_region_to_cpu(drawable, &region, flags))
-		return;
+	x = x1 = x2 = pt[0].x;
+	y = y1 = y2 = pt[0].y;
+	for (i = 1; i < n; i++) {
+		if (mode == CoordModeOrigin) {
+			x = pt[i].x;
+			y = pt[i].y;
+		} else {
+			x += pt[i].x;
+			y += pt[i].y;
+		}
+		x1 = MIN(x1, x); x2 = MAX(x2, x);
+		y1 = MIN(y1, y); y2 = MAX(y2, y);
+	}
+	return (uint64_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+}
+
+static uint64_t profile_text(GCPtr gc, int count)
+{
+	FontPtr font = gc->font;
+
+	return (uint64_t)count *
+		(FONTMAXBOUNDS(font, rightSideBearing) - FONTMINBOUNDS(font, leftSideBearing)) *
+		(FONTMAXBOUNDS(font, ascent) + FONTMAXBOUNDS(font, descent));
+}
+
+static uint64_t profile_char_info(unsigned n, CharInfoPtr *info)
+{
+	uint64_t pixels = 0;
+
+	while (n--) {
+		const xCharInfo *m = &(*info++)->metrics;
+		pixels += (m->rightSideBearing - m->leftSideBearing) *
+			(m->ascent + m->descent);
+	}
+	return pixels;
+}
+
+static void
+sna_fill_spans__profile(DrawablePtr drawable, GCPtr gc, int n,
+			DDXPointPtr pt, int *width, int sorted)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_FILL_SPANS, profile_spans(n, width),
+		sna_fill_spans(drawable, gc, n, pt, width, sorted));
+}
+
+static void
+sna_set_spans__profile(DrawablePtr drawable, GCPtr gc, char *src,
+		       DDXPointPtr pt, int *width, int n, int sorted)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_SET_SPANS, profile_spans(n, width),
+		sna_set_spans(drawable, gc, src, pt, width, n, sorted));
+}
+
+static void
+sna_put_image__profile(DrawablePtr drawable, GCPtr gc, int depth,
+		       int x, int y, int w, int h, int left, int format,
+		       char *bits)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_PUT_IMAGE, w * h,
+		sna_put_image(drawable, gc, depth, x, y, w, h, left, format, bits));
+}
+
+static RegionPtr
+sna_copy_area__profile(DrawablePtr src, DrawablePtr dst, GCPtr gc,
+		       int src_x, int src_y,
+		       int width, int height,
+		       int dst_x, int dst_y)
+{
+	struct sna *sna = to_sna_from_drawable(dst);
+	RegionPtr ret;
+
+	PROFILE(sna, PROFILE_COPY_AREA, width * height,
+		ret = sna_copy_area(src, dst, gc,
+				    src_x, src_y, width, height,
+				    dst_x, dst_y));
+	return ret;
+}
+
+static RegionPtr
+sna_copy_plane__profile(DrawablePtr src, DrawablePtr dst, GCPtr gc,
+			int src_x, int src_y,
+			int w, int h,
+			int dst_x, int dst_y,
+			unsigned long bit)
+{
+	struct sna *sna = to_sna_from_drawable(dst);
+	RegionPtr ret;
+
+	PROFILE(sna, PROFILE_COPY_PLANE, w * h,
+		ret = sna_copy_plane(src, dst, gc,
+				     src_x, src_y, w, h,
+				     dst_x, dst_y, bit));
+	return ret;
+}
+
+static void
+sna_poly_point__profile(DrawablePtr drawable, GCPtr gc,
+			int mode, int n, DDXPointPtr pt)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_POINT, n,
+		sna_poly_point(drawable, gc, mode, n, pt));
+}
+
+static void
+sna_poly_line__profile(DrawablePtr drawable, GCPtr gc,
+		       int mode, int n, DDXPointPtr pt)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_LINE, profile_line(mode, n, pt),
+		sna_poly_line(drawable, gc, mode, n, pt));
+}
+
+static void
+sna_poly_segment__profile(DrawablePtr drawable, GCPtr gc, int n, xSegment *seg)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_SEGMENT, profile_segments(n, seg),
+		sna_poly_segment(drawable, gc, n, seg));
+}
+
+static void
+sna_poly_rectangle__profile(DrawablePtr drawable, GCPtr gc, int n, xRectangle *r)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_RECTANGLE, profile_rect_outlines(n, r),
+		sna_poly_rectangle(drawable, gc, n, r));
+}
+
+static void
+sna_poly_arc__profile(DrawablePtr drawable, GCPtr gc, int n, xArc *arc)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_ARC, profile_arcs(n, arc, false),
+		sna_poly_arc(drawable, gc, n, arc));
+}
+
+static void
+sna_poly_fill_polygon__profile(DrawablePtr draw, GCPtr gc,
+			       int shape, int mode,
+			       int n, DDXPointPtr pt)
+{
+	struct sna *sna = to_sna_from_drawable(draw);
+	PROFILE(sna, PROFILE_FILL_POLYGON, profile_polygon(mode, n, pt),
+		sna_poly_fill_polygon(draw, gc, shape, mode, n, pt));
+}
+
+static void
+sna_poly_fill_rect__profile(DrawablePtr draw, GCPtr gc, int n, xRectangle *rect)
+{
+	struct sna *sna = to_sna_from_drawable(draw);
+	PROFILE(sna, PROFILE_POLY_FILL_RECT, profile_rects(n, rect),
+		sna_poly_fill_rect(draw, gc, n, rect));
+}
+
+static void
+sna_poly_fill_arc__profile(DrawablePtr draw, GCPtr gc, int n, xArc *arc)
+{
+	struct sna *sna = to_sna_from_drawable(draw);
+	PROFILE(sna, PROFILE_POLY_FILL_ARC, profile_arcs(n, arc, true),
+		sna_poly_fill_arc(draw, gc, n, arc));
+}
+
+static int
+sna_poly_text8__profile(DrawablePtr drawable, GCPtr gc,
+			int x, int y,
+			int count, char *chars)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	int ret;
+
+	PROFILE(sna, PROFILE_POLY_TEXT, profile_text(gc, count),
+		ret = sna_poly_text8(drawable, gc, x, y, count, chars));
+	return ret;
+}
+
+static int
+sna_poly_text16__profile(DrawablePtr drawable, GCPtr gc,
+			 int x, int y,
+			 int count, unsigned short *chars)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	int ret;
+
+	PROFILE(sna, PROFILE_POLY_TEXT, profile_text(gc, count),
+		ret = sna_poly_text16(drawable, gc, x, y, count, chars));
+	return ret;
+}
+
+static void
+sna_image_text8__profile(DrawablePtr drawable, GCPtr gc,
+			 int x, int y,
+			 int count, char *chars)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_IMAGE_TEXT, profile_text(gc, count),
+		sna_image_text8(drawable, gc, x, y, count, chars));
+}
+
+static void
+sna_image_text16__profile(DrawablePtr drawable, GCPtr gc,
+			  int x, int y,
+			  int count, unsigned short *chars)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_IMAGE_TEXT, profile_text(gc, count),
+		sna_image_text16(drawable, gc, x, y, count, chars));
+}
+
+static void
+sna_image_glyph__profile(DrawablePtr drawable, GCPtr gc,
+			 int x, int y, unsigned int n,
+			 CharInfoPtr *info, pointer base)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_IMAGE_GLYPH, profile_char_info(n, info),
+		sna_image_glyph(drawable, gc, x, y, n, info, base));
+}
+
+static void
+sna_poly_glyph__profile(DrawablePtr drawable, GCPtr gc,
+			int x, int y, unsigned int n,
+			CharInfoPtr *info, pointer base)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_POLY_GLYPH, profile_char_info(n, info),
+		sna_poly_glyph(drawable, gc, x, y, n, info, base));
+}
+
+static void
+sna_push_pixels__profile(GCPtr gc, PixmapPtr bitmap, DrawablePtr drawable,
+			 int w, int h,
+			 int x, int y)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_PUSH_PIXELS, w * h,
+		sna_push_pixels(gc, bitmap, drawable, w, h, x, y));
+}
+
+static const GCOps sna_gc_ops = {
+	sna_fill_spans__profile,
+	sna_set_spans__profile,
+	sna_put_image__profile,
+	sna_copy_area__profile,
+	sna_copy_plane__profile,
+	sna_poly_point__profile,
+	sna_poly_line__profile,
+	sna_poly_segment__profile,
+	sna_poly_rectangle__profile,
+	sna_poly_arc__profile,
+	sna_poly_fill_polygon__profile,
+	sna_poly_fill_rect__profile,
+	sna_poly_fill_arc__profile,
+	sna_poly_text8__profile,
+	sna_poly_text16__profile,
+	sna_image_text8__profile,
+	sna_image_text16__profile,
+	sna_image_glyph__profile,
+	sna_poly_glyph__profile,
+	sna_push_pixels__profile,
+};
+
+static const GCOps sna_gc_ops__cpu = {
+	fbFillSpans,
+	fbSetSpans,
+	fbPutImage,
+	fbCopyArea,
+	fbCopyPlane,
+	sna_poly_point__cpu,
+	fbPolyLine,
+	fbPolySegment,
+	miPolyRectangle,
+	fbPolyArc,
+	miFillPolygon,
+	fbPolyFillRect,
+	miPolyFillArc,
+	miPolyText8,
+	miPolyText16,
+	miImageText8,
+	miImageText16,
+	fbImageGlyphBlt,
+	fbPolyGlyphBlt,
+	fbPushPixels
+};
+
+static GCOps sna_gc_ops__tmp = {
+	sna_fill_spans,
+	sna_set_spans,
+	sna_put_image,
+	sna_copy_area,
+	sna_copy_plane,
+	sna_poly_point,
+	sna_poly_line,
+	sna_poly_segment,
+	sna_poly_rectangle,
+	sna_poly_arc,
+	sna_poly_fill_polygon,
+	sna_poly_fill_rect,
+	sna_poly_fill_arc,
+	sna_poly_text8,
+	sna_poly_text16,
+	sna_image_text8,
+	sna_image_text16,
+	sna_image_glyph,
+	sna_poly_glyph,
+	sna_push_pixels,
+};
+
+static void
+sna_validate_gc(GCPtr gc, unsigned long changes, DrawablePtr drawable)
+{
+	DBG(("%s changes=%lx\n", __FUNCTION__, changes));
+
+	if (changes & (GCClipMask|GCSubwindowMode) ||
+	    drawable->serialNumber != (gc->serialNumber & DRAWABLE_SERIAL_BITS) ||
+	    (gc->clientClipType != CT_NONE && (changes & (GCClipXOrigin | GCClipYOrigin))))
+		miComputeCompositeClip(gc, drawable);
+
+	sna_gc(gc)->changes |= changes;
+}
+
+static const GCFuncs sna_gc_funcs = {
+	sna_validate_gc,
+	miChangeGC,
+	miCopyGC,
+	miDestroyGC,
+	miChangeClip,
+	miDestroyClip,
+	miCopyClip
+};
+
+static const GCFuncs sna_gc_funcs__cpu = {
+	fbValidateGC,
+	miChangeGC,
+	miCopyGC,
+	miDestroyGC,
+	miChangeClip,
+	miDestroyClip,
+	miCopyClip
+};
+
+static int sna_create_gc(GCPtr gc)
+{
+	gc->miTranslate = 1;
+	gc->fExpose = 1;
+
+	fb_gc(gc)->bpp = bits_per_pixel(gc->depth);
+
+	gc->funcs = (GCFuncs *)&sna_gc_funcs;
+	gc->ops = (GCOps *)&sna_gc_ops;
+	return true;
+}
+
+/*
+ * Screen capture clients tend to repeatedly read back the same region
+ * (often the whole screen) every frame. Rather than stall the server
+ * on each GetImage waiting for the GPU to finish and then reading
+ * through an uncached mapping, we remember the last region requested
+ * and, as we flush the rendering for each frame, queue a blit of it
+ * into a snooped buffer. If nothing has been drawn over that region by
+ * the time the next request arrives, it is served straight from the
+ * completed buffer.
+ */
+#define READBACK_MIN_SIZE (64*64)
+#define READBACK_IDLE 1000 /* ms */
+
+static void sna_readback_destroy(DamagePtr damage, void *closure)
+{
+	struct sna *sna = closure;
+
+	DBG(("%s: pixmap destroyed\n", __FUNCTION__));
+
+	sna->readback.damage = NULL;
+	sna->readback.pixmap = NULL;
+	if (sna->readback.bo) {
+		kgem_bo_destroy(&sna->kgem, sna->readback.bo);
+		sna->readback.bo = NULL;
+	}
+}
+
+static void sna_readback_release(struct sna *sna)
+{
+	DBG(("%s\n", __FUNCTION__));
+
+	if (sna->readback.damage) {
+		DamageUnregister(&sna->readback.pixmap->drawable,
+				 sna->readback.damage);
+		DamageDestroy(sna->readback.damage);
+		sna->readback.damage = NULL;
+	}
+	sna->readback.pixmap = NULL;
+
+	if (sna->readback.bo) {
+		kgem_bo_destroy(&sna->kgem, sna->readback.bo);
+		sna->readback.bo = NULL;
+	}
+}
+
+static void sna_readback_expire(struct sna *sna)
+{
+	struct sna_readback *rb = &sna->readback;
+
+	if (rb->pixmap == NULL)
+		return;
+
+	if (currentTime.milliseconds - rb->time > READBACK_IDLE) {
+		DBG(("%s: no GetImage for %dms, stopping read-ahead\n",
+		     __FUNCTION__, currentTime.milliseconds - rb->time));
+		sna_readback_release(sna);
+	}
+}
+
+static bool
+sna_readback_too_large(struct sna *sna, const BoxRec *box, int bpp)
+{
+	int width = box->x2 - box->x1;
+	int height = box->y2 - box->y1;
+
+	/* The download is a single copy, so it must fit within both the
+	 * render and blitter limits and a single CPU bo.
+	 */
+	return (width  > sna->render.max_3d_size ||
+		height > sna->render.max_3d_size ||
+		width * bpp > (MAXSHORT - 512) * 8 ||
+		(uint64_t)width * height * bpp >> 3 > sna->kgem.max_copy_tile_size);
+}
+
+static bool
+sna_readback_stale(struct sna *sna, const BoxRec *box)
+{
+	RegionPtr damage = DamageRegion(sna->readback.damage);
+
+	if (sna->readback.stale)
+		return true;
+
+	return RegionNotEmpty(damage) &&
+		damage->extents.x1 < box->x2 && damage->extents.x2 > box->x1 &&
+		damage->extents.y1 < box->y2 && damage->extents.y2 > box->y1;
+}
+
+static bool
+sna_readback_get_image(struct sna *sna, PixmapPtr pixmap,
+		       const BoxRec *box, int depth, char *dst)
+{
+	struct sna_readback *rb = &sna->readback;
+	void *src;
+
+	if (rb->pixmap != pixmap || rb->bo == NULL)
+		return false;
+
+	rb->time = currentTime.milliseconds;
+
+	if (box->x1 < rb->box.x1 || box->x2 > rb->box.x2 ||
+	    box->y1 < rb->box.y1 || box->y2 > rb->box.y2) {
+		DBG(("%s: outside read-ahead (%d, %d), (%d, %d)\n",
+		     __FUNCTION__,
+		     rb->box.x1, rb->box.y1, rb->box.x2, rb->box.y2));
+		return false;
+	}
+
+	if (sna_readback_stale(sna, &rb->box)) {
+		DBG(("%s: read-ahead overwritten\n", __FUNCTION__));
+		return false;
+	}
+
+	src = kgem_bo_map__cpu(&sna->kgem, rb->bo);
+	if (src == NULL)
+		return false;
+
+	DBG(("%s: serving (%d, %d), (%d, %d) from read-ahead, busy? %d\n",
+	     __FUNCTION__, box->x1, box->y1, box->x2, box->y2,
+	     kgem_bo_is_busy(rb->bo)));
+
+	kgem_bo_sync__cpu(&sna->kgem, rb->bo);
+	memcpy_blt(src, dst, pixmap->drawable.bitsPerPixel,
+		   rb->bo->pitch, PixmapBytePad(box->x2 - box->x1, depth),
+		   box->x1 - rb->box.x1, box->y1 - rb->box.y1,
+		   0, 0, box->x2 - box->x1, box->y2 - box->y1);
+	rb->hits++;
+	return true;
+}
+
+static void
+sna_readback_track(struct sna *sna, PixmapPtr pixmap, const BoxRec *box)
+{
+	struct sna_readback *rb = &sna->readback;
+
+	if (sna_readback_too_large(sna, box, pixmap->drawable.bitsPerPixel)) {
+		DBG(("%s: (%d, %d), (%d, %d) too large to read ahead\n",
+		     __FUNCTION__, box->x1, box->y1, box->x2, box->y2));
+		return;
+	}
+
+	if (rb->pixmap != pixmap) {
+		sna_readback_release(sna);
+
+		rb->damage = DamageCreate(NULL, sna_readback_destroy,
+					  DamageReportNone, TRUE,
+					  pixmap->drawable.pScreen, sna);
+		if (rb->damage == NULL)
+			return;
+
+		DamageRegister(&pixmap->drawable, rb->damage);
+		rb->pixmap = pixmap;
+	}
+
+	DBG(("%s: tracking pixmap=%ld (%d, %d), (%d, %d) for read-ahead\n",
+	     __FUNCTION__, pixmap->drawable.serialNumber,
+	     box->x1, box->y1, box->x2, box->y2));
+
+	if (rb->bo &&
+	    (rb->box.x2 - rb->box.x1 != box->x2 - box->x1 ||
+	     rb->box.y2 - rb->box.y1 != box->y2 - box->y1)) {
+		kgem_bo_destroy(&sna->kgem, rb->bo);
+		rb->bo = NULL;
+	}
+
+	rb->box = *box;
+	rb->time = currentTime.milliseconds;
+	rb->misses++;
+
+	/* Mark the buffer as stale so that the next flush queues the download */
+	rb->stale = true;
+}
+
+static void sna_readahead(struct sna *sna)
+{
+	struct sna_readback *rb = &sna->readback;
+	struct sna_pixmap *priv;
+	PixmapRec tmp;
+
+	if (rb->pixmap == NULL)
+		return;
+
+	if (rb->bo && !sna_readback_stale(sna, &rb->box))
+		return;
+
+	priv = sna_pixmap(rb->pixmap);
+	if (priv == NULL || priv->gpu_bo == NULL || priv->gpu_damage == NULL)
+		return;
+
+	if (priv->cpu_damage &&
+	    sna_damage_overlaps_box(priv->cpu_damage, &rb->box))
+		return;
+
+	tmp.drawable.width = rb->box.x2 - rb->box.x1;
+	tmp.drawable.height = rb->box.y2 - rb->box.y1;
+	tmp.drawable.depth = rb->pixmap->drawable.depth;
+	tmp.drawable.bitsPerPixel = rb->pixmap->drawable.bitsPerPixel;
+	tmp.devPrivate.ptr = NULL;
+
+	if (rb->bo == NULL) {
+		rb->bo = kgem_create_cpu_2d(&sna->kgem,
+					    tmp.drawable.width,
+					    tmp.drawable.height,
+					    tmp.drawable.bitsPerPixel,
+					    0);
+		if (rb->bo == NULL)
+			return;
+	}
+
+	DBG(("%s: queueing download of pixmap=%ld (%d, %d), (%d, %d)\n",
+	     __FUNCTION__, rb->pixmap->drawable.serialNumber,
+	     rb->box.x1, rb->box.y1, rb->box.x2, rb->box.y2));
+
+	if (!sna->render.copy_boxes(sna, GXcopy,
+				    rb->pixmap, priv->gpu_bo, 0, 0,
+				    &tmp, rb->bo, -rb->box.x1, -rb->box.y1,
+				    &rb->box, 1, COPY_LAST)) {
+		kgem_bo_destroy(&sna->kgem, rb->bo);
+		rb->bo = NULL;
+		return;
+	}
+
+	kgem_bo_submit(&sna->kgem, rb->bo);
+	DamageEmpty(rb->damage);
+	rb->stale = false;
+	rb->issued++;
+}
+
+static void
+sna_get_image(DrawablePtr drawable,
+	      int x, int y, int w, int h,
+	      unsigned int format, unsigned long mask,
+	      char *dst)
+{
+	RegionRec region;
+	unsigned int flags;
+
+	if (!fbDrawableEnabled(drawable))
+		return;
+
+	DBG(("%s (%d, %d)x(%d, %d)\n", __FUNCTION__, x, y, w, h));
+
+	region.extents.x1 = x + drawable->x;
+	region.extents.y1 = y + drawable->y;
+	region.extents.x2 = region.extents.x1 + w;
+	region.extents.y2 = region.extents.y1 + h;
+	region.data = NULL;
+
+	if (format == ZPixmap &&
+	    drawable->bitsPerPixel >= 8 &&
+	    PM_IS_SOLID(drawable, mask) &&
+	    w * h >= READBACK_MIN_SIZE) {
+		PixmapPtr pixmap = get_drawable_pixmap(drawable);
+		struct sna *sna = to_sna_from_pixmap(pixmap);
+		struct sna_pixmap *priv = sna_pixmap(pixmap);
+		BoxRec box;
+		int16_t dx, dy;
+
+		get_drawable_deltas(drawable, pixmap, &dx, &dy);
+		box.x1 = region.extents.x1 + dx;
+		box.y1 = region.extents.y1 + dy;
+		box.x2 = region.extents.x2 + dx;
+		box.y2 = region.extents.y2 + dy;
+
+		if (sna_readback_get_image(sna, pixmap, &box,
+					   drawable->depth, dst))
+			return;
+
+		/* Only worth reading ahead if we would otherwise stall */
+		if (sna->kgem.can_blt_cpu && !wedged(sna) &&
+		    priv && priv->gpu_damage &&
+		    sna_damage_overlaps_box(priv->gpu_damage, &box))
+			sna_readback_track(sna, pixmap, &box);
+	}
+
+	flags = MOVE_READ;
+	if ((w | h) == 1)
+		flags |= MOVE_INPLACE_HINT;
+	if (w == drawable->width)
+		flags |= MOVE_WHOLE_HINT;
+	if (!sna_drawable_move_region_to_cpu(drawable, &region, flags))
+		return;
 
 	if (format == ZPixmap &&
 	    drawable->bitsPerPixel >= 8 &&
@@ -13621,6 +15186,9 @@ sna_copy_window(WindowPtr win, DDXPointRec origin, RegionPtr src)
 
 	if (wedged(sna) || FORCE_FALLBACK || !ACCEL_COPY_WINDOW) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		if (wedged(sna))
+			sna_fallback_reason(sna, FALLBACK_WEDGED);
+		sna_fallback_record(sna, &dst.extents);
 		if (!sna_pixmap_move_to_cpu(pixmap, MOVE_READ | MOVE_WRITE))
 			return;
 
@@ -13801,6 +15369,65 @@ static void timer_enable(struct sna *sna, int whom, int interval)
 	DBG(("%s (time=%ld), starting timer %d\n", __FUNCTION__, (long)TIME, whom));
 }
 
+static void timer_stats_add(struct sna_timer_interval *stats, int interval)
+{
+	if (stats->count == 0 || interval < stats->min)
+		stats->min = interval;
+	if (interval > stats->max)
+		stats->max = interval;
+	stats->sum += interval;
+	stats->count++;
+}
+
+/* The flush timer paces the updates to the scanout. If the GPU turns
+ * batches around quickly and the client is only trickling in
+ * requests, there is nothing to be gained by holding its rendering
+ * back for a whole frame, so flush sooner. Conversely, if the GPU is
+ * taking longer than a frame to complete each batch, flushing more
+ * often only breaks the work up into yet more, smaller batches, so
+ * let it accumulate for up to another frame.
+ */
+static int sna_accel_flush_interval(struct sna *sna)
+{
+	int interval = sna->vblank_interval ?: 20;
+	int latency = sna->kgem.retire_latency >> 4;
+
+	if (sna->timer_stats.submit_rate < 2 << 4 && 4 * latency < interval)
+		interval = MAX(interval / 2, MAX(2 * latency, 8));
+	else if (latency > interval)
+		interval = MIN(latency, 2 * interval);
+
+	DBG(("%s: latency=%dms, rate=%d/16, interval=%d\n", __FUNCTION__,
+	     latency, sna->timer_stats.submit_rate, interval));
+	return interval;
+}
+
+/* There is no point waking up to retire requests much before they
+ * are likely to have completed, nor in letting completed work sit
+ * around for longer than the old fixed period.
+ */
+static int sna_accel_throttle_interval(struct sna *sna)
+{
+	int latency = sna->kgem.retire_latency >> 4;
+
+	if (latency < 5)
+		return 5;
+	if (latency > 20)
+		return 20;
+	return latency;
+}
+
+static void sna_accel_update_submit_rate(struct sna *sna)
+{
+	struct sna_timer_stats *stats = &sna->timer_stats;
+	uint32_t batches = sna->kgem.nsubmit - stats->nsubmit;
+
+	if (batches > 64)
+		batches = 64;
+	stats->submit_rate = (3 * stats->submit_rate + (batches << 4)) / 4;
+	stats->nsubmit = sna->kgem.nsubmit;
+}
+
 static bool sna_accel_do_flush(struct sna *sna)
 {
 	struct sna_pixmap *priv;
@@ -13816,13 +15443,15 @@ static bool sna_accel_do_flush(struct sna *sna)
 	if (sna->flags & SNA_NO_DELAYED_FLUSH)
 		return true;
 
-	interval = sna->vblank_interval ?: 20;
+	interval = sna_accel_flush_interval(sna);
 	if (sna->timer_active & (1<<(FLUSH_TIMER))) {
 		int32_t delta = sna->timer_expire[FLUSH_TIMER] - TIME;
 		DBG(("%s: flush timer active: delta=%d\n",
 		     __FUNCTION__, delta));
 		if (delta <= 3) {
 			DBG(("%s (time=%ld), triggered\n", __FUNCTION__, (long)TIME));
+			sna_accel_update_submit_rate(sna);
+			timer_stats_add(&sna->timer_stats.flush, interval);
 			sna->timer_expire[FLUSH_TIMER] = TIME + interval;
 			return true;
 		}
@@ -13838,20 +15467,24 @@ static bool sna_accel_do_flush(struct sna *sna)
 
 static bool sna_accel_do_throttle(struct sna *sna)
 {
+	int interval;
+
 	if (sna->flags & SNA_NO_THROTTLE)
 		return false;
 
+	interval = sna_accel_throttle_interval(sna);
 	if (sna->timer_active & (1<<(THROTTLE_TIMER))) {
 		int32_t delta = sna->timer_expire[THROTTLE_TIMER] - TIME;
 		if (delta <= 3) {
 			DBG(("%s (time=%ld), triggered\n", __FUNCTION__, (long)TIME));
-			sna->timer_expire[THROTTLE_TIMER] = TIME + 20;
+			timer_stats_add(&sna->timer_stats.throttle, interval);
+			sna->timer_expire[THROTTLE_TIMER] = TIME + interval;
 			return true;
 		}
 	} else if (!sna->kgem.need_retire) {
 		DBG(("%s -- no pending activity\n", __FUNCTION__));
 	} else
-		timer_enable(sna, THROTTLE_TIMER, 20);
+		timer_enable(sna, THROTTLE_TIMER, interval);
 
 	return false;
 }
@@ -13866,7 +15499,7 @@ static bool sna_accel_do_expire(struct sna *sna)
 				TIME + MAX_INACTIVE_TIME * 1000;
 			return true;
 		}
-	} else if (sna->kgem.need_expire)
+	} else if (sna->kgem.need_expire || sna->readback.pixmap)
 		timer_enable(sna, EXPIRE_TIMER, MAX_INACTIVE_TIME * 1000);
 
 	return false;
@@ -14023,10 +15656,294 @@ static void sna_accel_expire(struct sna *sna)
 {
 	DBG(("%s (time=%ld)\n", __FUNCTION__, (long)TIME));
 
-	if (!kgem_expire_cache(&sna->kgem))
+	/* Also wakes us up to drop an idle read-ahead */
+	sna_readback_expire(sna);
+	if (!kgem_expire_cache(&sna->kgem) && sna->readback.pixmap == NULL)
 		sna_accel_disarm_timer(sna, EXPIRE_TIMER);
 }
 
+static bool sna_accel_do_report_stats(struct sna *sna)
+{
+	int32_t delta;
+
+	if ((sna->flags & SNA_REPORT_STATS) == 0)
+		return false;
+
+	delta = sna->timer_expire[STATS_TIMER] - TIME;
+	if (delta <= 3) {
+		sna->timer_expire[STATS_TIMER] = TIME + 10 * 1000;
+		return true;
+	} else
+		return false;
+}
+
+static void sna_accel_report_migration(struct sna *sna)
+{
+	if (sna->migrate.count[MIGRATE_TO_CPU] == 0 &&
+	    sna->migrate.count[MIGRATE_TO_GPU] == 0 &&
+	    sna->migrate.refused == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Pixmap migrations [%s]: %u to the GPU (%lluKiB), %u to the CPU (%lluKiB), %u refused\n",
+		   sna->migrate.policy->name,
+		   sna->migrate.count[MIGRATE_TO_GPU],
+		   (unsigned long long)(sna->migrate.bytes[MIGRATE_TO_GPU] >> 10),
+		   sna->migrate.count[MIGRATE_TO_CPU],
+		   (unsigned long long)(sna->migrate.bytes[MIGRATE_TO_CPU] >> 10),
+		   sna->migrate.refused);
+
+	memset(sna->migrate.count, 0, sizeof(sna->migrate.count));
+	memset(sna->migrate.bytes, 0, sizeof(sna->migrate.bytes));
+	sna->migrate.refused = 0;
+
+	if (sna->migrate.trace)
+		fflush(sna->migrate.trace);
+}
+
+static void sna_accel_report_readback(struct sna *sna)
+{
+	struct sna_readback *rb = &sna->readback;
+
+	if (rb->hits == 0 && rb->misses == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "GetImage read-ahead: %u served, %u missed, %u downloads queued\n",
+		   rb->hits, rb->misses, rb->issued);
+	rb->hits = rb->misses = rb->issued = 0;
+}
+
+static void sna_accel_report_uploads(struct sna *sna)
+{
+	if (sna->upload.count == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "PutImage uploads: %u, %llu KiB, %u blits coalesced\n",
+		   sna->upload.count,
+		   (unsigned long long)(sna->upload.bytes >> 10),
+		   sna->upload.coalesced);
+	sna->upload.count = sna->upload.coalesced = 0;
+	sna->upload.bytes = 0;
+}
+
+static void sna_accel_report_patterns(struct sna *sna)
+{
+	struct sna_pattern_cache *cache = &sna->patterns;
+
+	if (cache->hits == 0 && cache->misses == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Tile pattern cache: %u hits, %u misses\n",
+		   cache->hits, cache->misses);
+	cache->hits = cache->misses = 0;
+}
+
+static void sna_accel_report_timers(struct sna *sna)
+{
+	struct sna_timer_stats *stats = &sna->timer_stats;
+
+	if (stats->flush.count == 0 && stats->throttle.count == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Batch latency ~%d.%02dms, %d.%02d batches per flush\n",
+		   sna->kgem.retire_latency >> 4,
+		   100 * (sna->kgem.retire_latency & 15) / 16,
+		   stats->submit_rate >> 4,
+		   100 * (stats->submit_rate & 15) / 16);
+	if (stats->flush.count)
+		xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+			   "Flush timer: %u expiries, interval %u-%ums (average %u)\n",
+			   stats->flush.count, stats->flush.min, stats->flush.max,
+			   (unsigned)(stats->flush.sum / stats->flush.count));
+	if (stats->throttle.count)
+		xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+			   "Throttle timer: %u expiries, interval %u-%ums (average %u)\n",
+			   stats->throttle.count,
+			   stats->throttle.min, stats->throttle.max,
+			   (unsigned)(stats->throttle.sum / stats->throttle.count));
+
+	memset(&stats->flush, 0, sizeof(stats->flush));
+	memset(&stats->throttle, 0, sizeof(stats->throttle));
+}
+
+static volatile sig_atomic_t sna_profile_requests;
+
+static void sna_profile_signal(int sig)
+{
+	sna_profile_requests++;
+}
+
+static void sna_accel_report_profile(struct sna *sna)
+{
+	static const char *names[PROFILE_NUM_OPS] = {
+		[PROFILE_FILL_SPANS] = "FillSpans",
+		[PROFILE_SET_SPANS] = "SetSpans",
+		[PROFILE_PUT_IMAGE] = "PutImage",
+		[PROFILE_COPY_AREA] = "CopyArea",
+		[PROFILE_COPY_PLANE] = "CopyPlane",
+		[PROFILE_POLY_POINT] = "PolyPoint",
+		[PROFILE_POLY_LINE] = "PolyLine",
+		[PROFILE_POLY_SEGMENT] = "PolySegment",
+		[PROFILE_POLY_RECTANGLE] = "PolyRectangle",
+		[PROFILE_POLY_ARC] = "PolyArc",
+		[PROFILE_FILL_POLYGON] = "FillPolygon",
+		[PROFILE_POLY_FILL_RECT] = "PolyFillRect",
+		[PROFILE_POLY_FILL_ARC] = "PolyFillArc",
+		[PROFILE_POLY_TEXT] = "PolyText",
+		[PROFILE_IMAGE_TEXT] = "ImageText",
+		[PROFILE_IMAGE_GLYPH] = "ImageGlyphBlt",
+		[PROFILE_POLY_GLYPH] = "PolyGlyphBlt",
+		[PROFILE_PUSH_PIXELS] = "PushPixels",
+		[PROFILE_GET_IMAGE] = "GetImage",
+		[PROFILE_COPY_WINDOW] = "CopyWindow",
+		[PROFILE_COMPOSITE] = "Composite",
+		[PROFILE_COMPOSITE_RECTS] = "FillRectangles",
+		[PROFILE_GLYPHS] = "CompositeGlyphs",
+		[PROFILE_TRAPEZOIDS] = "Trapezoids",
+		[PROFILE_TRIANGLES] = "Triangles",
+	};
+	struct sna_profile *profile = &sna->profile;
+	int order[PROFILE_NUM_OPS];
+	uint64_t total = 0;
+	uint32_t now;
+	int i, j;
+
+	/* Sort by time spent, most expensive first */
+	for (i = 0; i < PROFILE_NUM_OPS; i++) {
+		uint64_t cycles = profile->op[i].cycles;
+
+		for (j = i; j > 0 && profile->op[order[j-1]].cycles < cycles; j--)
+			order[j] = order[j-1];
+		order[j] = i;
+		total += cycles;
+	}
+
+	now = GetTimeInMillis();
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Request profile over the last %u.%03us:\n",
+		   (now - profile->start_time) / 1000,
+		   (now - profile->start_time) % 1000);
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "  %-16s %10s %12s %10s %12s %6s\n",
+		   "request", "calls", "kpixels", "fallbacks", "kcycles", "%");
+	for (i = 0; i < PROFILE_NUM_OPS; i++) {
+		const struct sna_profile_counter *c = &profile->op[order[i]];
+
+		if (c->calls == 0)
+			break;
+
+		xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+			   "  %-16s %10llu %12llu %10llu %12llu %6.2f\n",
+			   names[order[i]],
+			   (unsigned long long)c->calls,
+			   (unsigned long long)(c->pixels >> 10),
+			   (unsigned long long)c->fallbacks,
+			   (unsigned long long)(c->cycles / 1000),
+			   total ? 100. * c->cycles / total : 0.);
+	}
+
+	memset(profile->op, 0, sizeof(profile->op));
+	profile->start_time = now;
+	profile->dumped = sna_profile_requests;
+}
+
+static void sna_accel_report_fallbacks(struct sna *sna)
+{
+	static const char *names[FALLBACK_NUM_REASONS] = {
+		[FALLBACK_DECLINED] = "declined",
+		[FALLBACK_WEDGED] = "wedged",
+		[FALLBACK_UNATTACHED] = "unattached",
+		[FALLBACK_CPU] = "cpu-preferred",
+		[FALLBACK_MIGRATE] = "migration",
+		[FALLBACK_TILING] = "tiling",
+		[FALLBACK_PLANEMASK] = "planemask",
+		[FALLBACK_FILL] = "fill-style",
+		[FALLBACK_LINE] = "wide/dashed",
+		[FALLBACK_FONT] = "large-font",
+		[FALLBACK_ALPHA_MAP] = "alpha-map",
+		[FALLBACK_RENDER] = "render",
+		[FALLBACK_SPANS] = "spans",
+	};
+	struct sna_fallback_stats *stats = &sna->fallback;
+	uint64_t count = 0;
+	int i;
+
+	for (i = 0; i < FALLBACK_NUM_REASONS; i++)
+		count += stats->reason[i].count;
+	if (count == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Fallbacks: %llu\n", (unsigned long long)count);
+	for (i = 0; i < FALLBACK_NUM_REASONS; i++) {
+		const struct sna_fallback_counter *c = &stats->reason[i];
+
+		if (c->count == 0)
+			continue;
+
+		xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+			   "  %-16s %10llu (%llu kpixels)\n",
+			   names[i],
+			   (unsigned long long)c->count,
+			   (unsigned long long)(c->pixels >> 10));
+	}
+
+	memset(stats->reason, 0, sizeof(stats->reason));
+}
+
+static void sna_accel_report_requests(struct sna *sna)
+{
+	if (sna->flags & SNA_PROFILE)
+		sna_accel_report_profile(sna);
+	sna_accel_report_fallbacks(sna);
+	sna->profile.dumped = sna_profile_requests;
+}
+
+static void sna_accel_profile_init(struct sna *sna)
+{
+	static bool installed;
+
+	memset(&sna->fallback, 0, sizeof(sna->fallback));
+
+	if ((sna->flags & (SNA_PROFILE | SNA_REPORT_STATS)) == 0)
+		return;
+
+	memset(&sna->profile, 0, sizeof(sna->profile));
+	sna->profile.start_time = GetTimeInMillis();
+	sna->profile.dumped = sna_profile_requests;
+
+	/* Shared by all screens, each reports upon its next wakeup */
+	if (!installed) {
+		struct sigaction sa;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = sna_profile_signal;
+		sigemptyset(&sa.sa_mask);
+		installed = sigaction(SIGUSR2, &sa, NULL) == 0;
+	}
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "%s%s\n",
+		   sna->flags & SNA_PROFILE ? "Profiling requests" : "Counting fallbacks",
+		   installed ? ", send SIGUSR2 to report" : "");
+}
+
+static void sna_accel_report_stats(struct sna *sna)
+{
+	sna_accel_report_requests(sna);
+	sna_accel_report_timers(sna);
+	sna_accel_report_migration(sna);
+	sna_accel_report_readback(sna);
+	sna_accel_report_uploads(sna);
+	sna_accel_report_patterns(sna);
+	sna_mode_report_stats(sna);
+	sna_dri_report_stats(sna);
+}
+
 #ifdef DEBUG_MEMORY
 static bool sna_accel_do_debug_memory(struct sna *sna)
 {
@@ -14131,6 +16048,143 @@ static void sna_store_colors(ColormapPtr cmap, int n, xColorItem *def)
 {
 }
 
+static void
+sna_get_image__profile(DrawablePtr drawable,
+		       int x, int y, int w, int h,
+		       unsigned int format, unsigned long mask,
+		       char *dst)
+{
+	struct sna *sna = to_sna_from_drawable(drawable);
+	PROFILE(sna, PROFILE_GET_IMAGE, w * h,
+		sna_get_image(drawable, x, y, w, h, format, mask, dst));
+}
+
+static void
+sna_copy_window__profile(WindowPtr win, DDXPointRec origin, RegionPtr src)
+{
+	struct sna *sna = to_sna_from_drawable(&win->drawable);
+	PROFILE(sna, PROFILE_COPY_WINDOW,
+		(uint64_t)(src->extents.x2 - src->extents.x1) *
+		(src->extents.y2 - src->extents.y1),
+		sna_copy_window(win, origin, src));
+}
+
+static void
+sna_composite__profile(CARD8 op,
+		       PicturePtr src,
+		       PicturePtr mask,
+		       PicturePtr dst,
+		       INT16 src_x,  INT16 src_y,
+		       INT16 mask_x, INT16 mask_y,
+		       INT16 dst_x,  INT16 dst_y,
+		       CARD16 width, CARD16 height)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	PROFILE(sna, PROFILE_COMPOSITE, width * height,
+		sna_composite(op, src, mask, dst,
+			      src_x, src_y, mask_x, mask_y,
+			      dst_x, dst_y, width, height));
+}
+
+static void
+sna_composite_rectangles__profile(CARD8 op,
+				  PicturePtr dst,
+				  xRenderColor *color,
+				  int num_rects,
+				  xRectangle *rects)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	PROFILE(sna, PROFILE_COMPOSITE_RECTS, profile_rects(num_rects, rects),
+		sna_composite_rectangles(op, dst, color, num_rects, rects));
+}
+
+static uint64_t profile_glyphs(int nlist, GlyphListPtr list, GlyphPtr *glyphs)
+{
+	uint64_t pixels = 0;
+
+	while (nlist--) {
+		int n = list++->len;
+		while (n--) {
+			GlyphPtr g = *glyphs++;
+			pixels += g->info.width * g->info.height;
+		}
+	}
+	return pixels;
+}
+
+static void
+sna_glyphs__profile(CARD8 op,
+		    PicturePtr src,
+		    PicturePtr dst,
+		    PictFormatPtr mask,
+		    INT16 src_x, INT16 src_y,
+		    int nlist, GlyphListPtr list, GlyphPtr *glyphs)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	PROFILE(sna, PROFILE_GLYPHS, profile_glyphs(nlist, list, glyphs),
+		sna_glyphs(op, src, dst, mask, src_x, src_y,
+			   nlist, list, glyphs));
+}
+
+static void
+sna_glyphs__shared__profile(CARD8 op,
+			    PicturePtr src,
+			    PicturePtr dst,
+			    PictFormatPtr mask,
+			    INT16 src_x, INT16 src_y,
+			    int nlist, GlyphListPtr list, GlyphPtr *glyphs)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	PROFILE(sna, PROFILE_GLYPHS, profile_glyphs(nlist, list, glyphs),
+		sna_glyphs__shared(op, src, dst, mask, src_x, src_y,
+				   nlist, list, glyphs));
+}
+
+static uint64_t profile_trapezoids(int n, const xTrapezoid *t)
+{
+	uint64_t pixels = 0;
+
+	for (; n--; t++) {
+		xFixed x1 = MIN(MIN(t->left.p1.x, t->left.p2.x),
+				MIN(t->right.p1.x, t->right.p2.x));
+		xFixed x2 = MAX(MAX(t->left.p1.x, t->left.p2.x),
+				MAX(t->right.p1.x, t->right.p2.x));
+		if (t->bottom > t->top && x2 > x1)
+			pixels += (uint64_t)pixman_fixed_to_int(x2 - x1 + pixman_fixed_1 - 1) *
+				pixman_fixed_to_int(t->bottom - t->top + pixman_fixed_1 - 1);
+	}
+	return pixels;
+}
+
+static void
+sna_composite_trapezoids__profile(CARD8 op,
+				  PicturePtr src,
+				  PicturePtr dst,
+				  PictFormatPtr maskFormat,
+				  INT16 xSrc, INT16 ySrc,
+				  int ntrap, xTrapezoid *traps)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	PROFILE(sna, PROFILE_TRAPEZOIDS, profile_trapezoids(ntrap, traps),
+		sna_composite_trapezoids(op, src, dst, maskFormat,
+					 xSrc, ySrc, ntrap, traps));
+}
+
+static void
+sna_composite_triangles__profile(CARD8 op,
+				 PicturePtr src,
+				 PicturePtr dst,
+				 PictFormatPtr maskFormat,
+				 INT16 xSrc, INT16 ySrc,
+				 int ntri, xTriangle *tri)
+{
+	struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+	/* Pixels are not estimated for triangles */
+	PROFILE(sna, PROFILE_TRIANGLES, 0,
+		sna_composite_triangles(op, src, dst, maskFormat,
+					xSrc, ySrc, ntri, tri));
+}
+
 static bool sna_picture_init(ScreenPtr screen)
 {
 	PictureScreenPtr ps;
@@ -14157,9 +16211,54 @@ static bool sna_picture_init(ScreenPtr screen)
 	ps->TriFan = sna_composite_trifan;
 #endif
 
+	if (to_sna_from_screen(screen)->flags & SNA_PROFILE) {
+		ps->Composite = sna_composite__profile;
+		ps->CompositeRects = sna_composite_rectangles__profile;
+		if (ps->Glyphs == sna_glyphs__shared)
+			ps->Glyphs = sna_glyphs__shared__profile;
+		else
+			ps->Glyphs = sna_glyphs__profile;
+		ps->Trapezoids = sna_composite_trapezoids__profile;
+		ps->Triangles = sna_composite_triangles__profile;
+	}
+
 	return true;
 }
 
+static void sna_accel_migrate_init(struct sna *sna)
+{
+	const char *str;
+
+	sna->migrate.policy = &sna_migrate_greedy;
+	str = xf86GetOptValString(sna->Options, OPTION_MIGRATION_POLICY);
+	if (str) {
+		const struct sna_migrate_policy *policy;
+
+		policy = sna_migrate_policy_lookup(str);
+		if (policy)
+			sna->migrate.policy = policy;
+		else
+			xf86DrvMsg(sna->scrn->scrnIndex, X_ERROR,
+				   "unrecognised pixmap migration policy '%s'\n",
+				   str);
+	}
+	xf86DrvMsg(sna->scrn->scrnIndex,
+		   sna->migrate.policy != &sna_migrate_greedy ? X_CONFIG : X_DEFAULT,
+		   "Pixmap migration policy: %s\n", sna->migrate.policy->name);
+
+	str = xf86GetOptValString(sna->Options, OPTION_MIGRATION_TRACE);
+	if (str) {
+		sna->migrate.trace = fopen(str, "w");
+		if (sna->migrate.trace)
+			xf86DrvMsg(sna->scrn->scrnIndex, X_CONFIG,
+				   "Recording pixmap migrations to '%s'\n", str);
+		else
+			xf86DrvMsg(sna->scrn->scrnIndex, X_ERROR,
+				   "failed to open migration trace '%s': %s\n",
+				   str, strerror(errno));
+	}
+}
+
 bool sna_accel_init(ScreenPtr screen, struct sna *sna)
 {
 	const char *backend;
@@ -14171,11 +16270,15 @@ bool sna_accel_init(ScreenPtr screen, struct sna *sna)
 	list_init(&sna->flush_pixmaps);
 	list_init(&sna->active_pixmaps);
 
+	sna_accel_migrate_init(sna);
+	sna_accel_profile_init(sna);
+
 	AddGeneralSocket(sna->kgem.fd);
 
 #ifdef DEBUG_MEMORY
 	sna->timer_expire[DEBUG_MEMORY_TIMER] = GetTimeInMillis()+ 10 * 1000;
 #endif
+	sna->timer_expire[STATS_TIMER] = GetTimeInMillis() + 10 * 1000;
 
 	screen->defColormap = FakeClientID(0);
 	/* let CreateDefColormap do whatever it wants for pixels */
@@ -14226,6 +16329,11 @@ bool sna_accel_init(ScreenPtr screen, struct sna *sna)
 	assert(screen->SetWindowPixmap == NULL);
 	screen->SetWindowPixmap = sna_set_window_pixmap;
 
+	if (sna->flags & SNA_PROFILE) {
+		screen->GetImage = sna_get_image__profile;
+		screen->CopyWindow = sna_copy_window__profile;
+	}
+
 	if (sna->kgem.has_userptr)
 		ShmRegisterFuncs(screen, &shm_funcs);
 	else
@@ -14316,6 +16424,17 @@ void sna_accel_close(struct sna *sna)
 {
 	DBG(("%s\n", __FUNCTION__));
 
+	if (sna->migrate.trace) {
+		fclose(sna->migrate.trace);
+		sna->migrate.trace = NULL;
+	}
+
+	sna_readback_release(sna);
+	sna_pattern_cache_fini(sna);
+
+	if (sna->flags & (SNA_PROFILE | SNA_REPORT_STATS))
+		sna_accel_report_requests(sna);
+
 	sna_composite_close(sna);
 	sna_gradients_close(sna);
 	sna_glyphs_close(sna);
@@ -14343,8 +16462,11 @@ void sna_accel_block_handler(struct sna *sna, struct timeval **tv)
 		_kgem_submit(&sna->kgem);
 	}
 
-	if (sna_accel_do_flush(sna))
+	sna_readback_expire(sna);
+	if (sna_accel_do_flush(sna)) {
 		sna_accel_flush(sna);
+		sna_readahead(sna);
+	}
 	assert(sna->flags & SNA_NO_DELAYED_FLUSH ||
 	       sna_accel_scanout(sna) == NULL ||
 	       sna_accel_scanout(sna)->gpu_bo->exec == NULL ||
@@ -14364,6 +16486,13 @@ void sna_accel_block_handler(struct sna *sna, struct timeval **tv)
 	if (sna_accel_do_debug_memory(sna))
 		sna_accel_debug_memory(sna);
 
+	if (sna_accel_do_report_stats(sna))
+		sna_accel_report_stats(sna);
+
+	if (sna->flags & (SNA_PROFILE | SNA_REPORT_STATS) &&
+	    sna->profile.dumped != sna_profile_requests)
+		sna_accel_report_requests(sna);
+
 	if (sna->watch_flush == 1) {
 		DBG(("%s: removing watchers\n", __FUNCTION__));
 		DeleteCallback(&FlushCallback, sna_accel_flush_callback, sna);
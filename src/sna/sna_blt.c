@@ -89,7 +89,12 @@ static void nop_done(struct sna *sna, const struct sna_composite_op *op)
 	(void)op;
 }
 
-static void gen6_blt_copy_done(struct sna *sna, const struct sna_composite_op *op)
+/* On gen6+ each run of copies is terminated by a dummy XY_SETUP_CLIP.
+ * Scrolling clients issue many CopyArea requests back to back, so if
+ * nothing else has been emitted since we closed the last copy, reopen
+ * it by discarding its terminator and let the next copy extend the run.
+ */
+static void gen6_blt_copy_close(struct sna *sna)
 {
 	struct kgem *kgem = &sna->kgem;
 
@@ -99,8 +104,33 @@ static void gen6_blt_copy_done(struct sna *sna, const struct sna_composite_op *o
 		b[1] = b[2] = 0;
 		kgem->nbatch += 3;
 		assert(kgem->nbatch < kgem->surface);
+		sna->blt_state.copy_end = kgem->nbatch;
 	}
 	assert(sna->kgem.nbatch <= KGEM_BATCH_SIZE(&sna->kgem));
+}
+
+static void gen6_blt_copy_reopen(struct sna *sna)
+{
+	struct kgem *kgem = &sna->kgem;
+
+	/* copy_end is 0 until a copy has been closed in this batch */
+	if (kgem->gen < 60 ||
+	    sna->blt_state.copy_end == 0 ||
+	    kgem->nbatch != sna->blt_state.copy_end ||
+	    kgem->nbatch < 3 ||
+	    kgem->mode != KGEM_BLT)
+		return;
+
+	if (kgem->batch[kgem->nbatch-3] == XY_SETUP_CLIP) {
+		DBG(("%s: continuing previous copy\n", __FUNCTION__));
+		kgem->nbatch -= 3;
+	}
+	sna->blt_state.copy_end = 0;
+}
+
+static void gen6_blt_copy_done(struct sna *sna, const struct sna_composite_op *op)
+{
+	gen6_blt_copy_close(sna);
 	(void)op;
 }
 
@@ -296,6 +326,7 @@ static bool sna_blt_copy_init(struct sna *sna,
 			return false;
 		_kgem_set_mode(kgem, KGEM_BLT);
 	}
+	gen6_blt_copy_reopen(sna);
 
 	sna->blt_state.fill_bo = 0;
 	return true;
@@ -348,6 +379,7 @@ static bool sna_blt_alpha_fixup_init(struct sna *sna,
 			return false;
 		_kgem_set_mode(kgem, KGEM_BLT);
 	}
+	gen6_blt_copy_reopen(sna);
 
 	sna->blt_state.fill_bo = 0;
 	return true;
@@ -2494,6 +2526,7 @@ bool sna_blt_copy_boxes(struct sna *sna, uint8_t alu,
 							 bpp, box, nbox);
 		_kgem_set_mode(kgem, KGEM_BLT);
 	}
+	gen6_blt_copy_reopen(sna);
 
 	if ((dst_dx | dst_dy) == 0) {
 		uint64_t hdr = (uint64_t)br13 << 32 | cmd;
@@ -2602,13 +2635,8 @@ bool sna_blt_copy_boxes(struct sna *sna, uint8_t alu,
 		} while (1);
 	}
 
-	if (kgem->gen >= 60 && kgem_check_batch(kgem, 3)) {
-		uint32_t *b = kgem->batch + kgem->nbatch;
-		b[0] = XY_SETUP_CLIP;
-		b[1] = b[2] = 0;
-		kgem->nbatch += 3;
-		assert(kgem->nbatch < kgem->surface);
-	}
+	if (kgem->gen >= 60)
+		gen6_blt_copy_close(sna);
 
 	sna->blt_state.fill_bo = 0;
 	return true;
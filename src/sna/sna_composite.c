@@ -494,11 +494,13 @@ sna_composite(CARD8 op,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	if (dst->alphaMap) {
 		DBG(("%s: fallback due to unhandled alpha-map\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_ALPHA_MAP);
 		goto fallback;
 	}
 
@@ -506,6 +508,7 @@ sna_composite(CARD8 op,
 	if (priv == NULL) {
 		DBG(("%s: fallback as destination pixmap=%ld is unattached\n",
 		     __FUNCTION__, pixmap->drawable.serialNumber));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -513,6 +516,7 @@ sna_composite(CARD8 op,
 	    !picture_is_gpu(src) && !picture_is_gpu(mask)) {
 		DBG(("%s: fallback, dst pixmap=%ld is too small (or completely damaged)\n",
 		     __FUNCTION__, pixmap->drawable.serialNumber));
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
 	}
 
@@ -554,6 +558,7 @@ sna_composite(CARD8 op,
 				   region.extents.y2 - region.extents.y1,
 				   memset(&tmp, 0, sizeof(tmp)))) {
 		DBG(("%s: fallback due unhandled composite op\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_RENDER);
 		goto fallback;
 	}
 
@@ -581,6 +586,7 @@ fallback:
 	else
 		flags = MOVE_WRITE | MOVE_READ;
 	DBG(("%s: fallback -- move dst to cpu\n", __FUNCTION__));
+	sna_fallback_record(sna, &region.extents);
 	if (!sna_drawable_move_region_to_cpu(dst->pDrawable, &region, flags))
 		goto out;
 	if (dst->alphaMap &&
@@ -804,11 +810,14 @@ sna_composite_rectangles(CARD8		 op,
 	if (NO_COMPOSITE_RECTANGLES)
 		goto fallback;
 
-	if (wedged(sna))
+	if (wedged(sna)) {
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
+	}
 
 	if (dst->alphaMap) {
 		DBG(("%s: fallback, dst has an alpha-map\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_ALPHA_MAP);
 		goto fallback;
 	}
 
@@ -816,6 +825,7 @@ sna_composite_rectangles(CARD8		 op,
 	if (priv == NULL || too_small(priv)) {
 		DBG(("%s: fallback, dst pixmap=%ld too small or not attached\n",
 		     __FUNCTION__, pixmap->drawable.serialNumber));
+		sna_fallback_reason(sna, priv ? FALLBACK_CPU : FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -864,6 +874,7 @@ sna_composite_rectangles(CARD8		 op,
 				 &region.extents, &damage);
 	if (bo == NULL) {
 		DBG(("%s: fallback due to no GPU bo\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
 	}
 
@@ -912,6 +923,7 @@ sna_composite_rectangles(CARD8		 op,
 
 fallback:
 	DBG(("%s: fallback\n", __FUNCTION__));
+	sna_fallback_record(sna, &region.extents);
 	if (op <= PictOpSrc)
 		error = MOVE_WRITE;
 	else
@@ -64,6 +64,8 @@ struct sna_crtc {
 	int dpms_mode;
 	PixmapPtr scanout_pixmap;
 	struct kgem_bo *bo;
+	struct kgem_bo *back;
+	RegionRec back_damage;
 	uint32_t cursor;
 	bool shadow;
 	bool fallback_shadow;
@@ -768,6 +770,16 @@ static void sna_crtc_disable_shadow(struct sna *sna, struct sna_crtc *crtc)
 	crtc->shadow = false;
 }
 
+static void sna_crtc_free_back(struct sna *sna, struct sna_crtc *crtc)
+{
+	if (crtc->back) {
+		kgem_bo_destroy(&sna->kgem, crtc->back);
+		crtc->back = NULL;
+	}
+	RegionUninit(&crtc->back_damage);
+	RegionNull(&crtc->back_damage);
+}
+
 static void
 sna_crtc_disable(xf86CrtcPtr crtc)
 {
@@ -782,6 +794,7 @@ sna_crtc_disable(xf86CrtcPtr crtc)
 	(void)drmIoctl(sna->kgem.fd, DRM_IOCTL_MODE_SETCRTC, &arg);
 
 	sna_crtc_disable_shadow(sna, sna_crtc);
+	sna_crtc_free_back(sna, sna_crtc);
 
 	if (sna_crtc->bo) {
 		kgem_bo_destroy(&sna->kgem, sna_crtc->bo);
@@ -1271,6 +1284,7 @@ retry: /* Attach per-crtc pixmap or direct */
 	}
 	if (saved_bo)
 		kgem_bo_destroy(&sna->kgem, saved_bo);
+	sna_crtc_free_back(sna, sna_crtc);
 
 	sna_crtc_randr(crtc);
 	if (sna_crtc->shadow)
@@ -2917,10 +2931,10 @@ void sna_mode_update(struct sna *sna)
 }
 
 static void
-sna_crtc_redisplay__fallback(xf86CrtcPtr crtc, RegionPtr region)
+sna_crtc_redisplay__fallback(xf86CrtcPtr crtc, RegionPtr region,
+			     struct kgem_bo *bo)
 {
 	struct sna *sna = to_sna(crtc->scrn);
-	struct sna_crtc *sna_crtc = to_sna_crtc(crtc);
 	ScreenPtr screen = sna->scrn->pScreen;
 	PictFormatPtr format;
 	PicturePtr src, dst;
@@ -2931,7 +2945,7 @@ sna_crtc_redisplay__fallback(xf86CrtcPtr crtc, RegionPtr region)
 
 	DBG(("%s: compositing transformed damage boxes\n", __FUNCTION__));
 
-	ptr = kgem_bo_map__gtt(&sna->kgem, sna_crtc->bo);
+	ptr = kgem_bo_map__gtt(&sna->kgem, bo);
 	if (ptr == NULL)
 		return;
 
@@ -2945,7 +2959,7 @@ sna_crtc_redisplay__fallback(xf86CrtcPtr crtc, RegionPtr region)
 					crtc->mode.VDisplay,
 					sna->front->drawable.depth,
 					sna->front->drawable.bitsPerPixel,
-					sna_crtc->bo->pitch, ptr))
+					bo->pitch, ptr))
 		goto free_pixmap;
 
 	error = sna_render_format_for_depth(sna->front->drawable.depth);
@@ -2976,7 +2990,7 @@ sna_crtc_redisplay__fallback(xf86CrtcPtr crtc, RegionPtr region)
 	if (!dst)
 		goto free_src;
 
-	kgem_bo_sync__gtt(&sna->kgem, sna_crtc->bo);
+	kgem_bo_sync__gtt(&sna->kgem, bo);
 	n = REGION_NUM_RECTS(region);
 	b = REGION_RECTS(region);
 	do {
@@ -3009,10 +3023,10 @@ free_pixmap:
 }
 
 static void
-sna_crtc_redisplay__composite(xf86CrtcPtr crtc, RegionPtr region)
+sna_crtc_redisplay__composite(xf86CrtcPtr crtc, RegionPtr region,
+			      struct kgem_bo *bo)
 {
 	struct sna *sna = to_sna(crtc->scrn);
-	struct sna_crtc *sna_crtc = to_sna_crtc(crtc);
 	ScreenPtr screen = sna->scrn->pScreen;
 	struct sna_composite_op tmp;
 	PictFormatPtr format;
@@ -3030,7 +3044,7 @@ sna_crtc_redisplay__composite(xf86CrtcPtr crtc, RegionPtr region)
 	if (pixmap == NullPixmap)
 		return;
 
-	if (!sna_pixmap_attach_to_bo(pixmap, sna_crtc->bo))
+	if (!sna_pixmap_attach_to_bo(pixmap, bo))
 		goto free_pixmap;
 
 	error = sna_render_format_for_depth(sna->front->drawable.depth);
@@ -3072,7 +3086,7 @@ sna_crtc_redisplay__composite(xf86CrtcPtr crtc, RegionPtr region)
 				   0, 0,
 				   memset(&tmp, 0, sizeof(tmp)))) {
 		DBG(("%s: unsupported operation!\n", __FUNCTION__));
-		sna_crtc_redisplay__fallback(crtc, region);
+		sna_crtc_redisplay__fallback(crtc, region, bo);
 		goto free_dst;
 	}
 
@@ -3106,7 +3120,7 @@ free_pixmap:
 }
 
 static void
-sna_crtc_redisplay(xf86CrtcPtr crtc, RegionPtr region)
+sna_crtc_redisplay(xf86CrtcPtr crtc, RegionPtr region, struct kgem_bo *bo)
 {
 	struct sna *sna = to_sna(crtc->scrn);
 	struct sna_crtc *sna_crtc = to_sna_crtc(crtc);
@@ -3138,17 +3152,111 @@ sna_crtc_redisplay(xf86CrtcPtr crtc, RegionPtr region)
 
 		if (sna->render.copy_boxes(sna, GXcopy,
 					   sna->front, sna_pixmap_get_bo(sna->front), 0, 0,
-					   &tmp, sna_crtc->bo, -tx, -ty,
+					   &tmp, bo, -tx, -ty,
 					   REGION_RECTS(region), REGION_NUM_RECTS(region), 0))
 			return;
 	}
 
-	sna_crtc_redisplay__composite(crtc, region);
+	sna_crtc_redisplay__composite(crtc, region, bo);
+}
+
+static uint64_t region_bytes(RegionPtr region, int bpp)
+{
+	const BoxRec *box = REGION_RECTS(region);
+	int n = REGION_NUM_RECTS(region);
+	uint64_t pixels = 0;
+
+	while (n--) {
+		pixels += (box->x2 - box->x1) * (box->y2 - box->y1);
+		box++;
+	}
+
+	return pixels * bpp / 8;
+}
+
+static bool
+sna_crtc_redisplay__flip(xf86CrtcPtr crtc, RegionPtr region)
+{
+	struct sna *sna = to_sna(crtc->scrn);
+	struct sna_crtc *sna_crtc = to_sna_crtc(crtc);
+	struct drm_mode_crtc_page_flip arg;
+	struct kgem_bo *bo;
+
+	if (sna_crtc->back == NULL) {
+		DBG(("%s: allocating back buffer for crtc %d\n",
+		     __FUNCTION__, sna_crtc->id));
+
+		bo = kgem_create_2d(&sna->kgem,
+				    crtc->mode.HDisplay, crtc->mode.VDisplay,
+				    sna->scrn->bitsPerPixel,
+				    sna_crtc->bo->tiling, CREATE_SCANOUT);
+		if (bo == NULL)
+			return false;
+
+		if (!get_fb(sna, bo, crtc->mode.HDisplay, crtc->mode.VDisplay)) {
+			kgem_bo_destroy(&sna->kgem, bo);
+			return false;
+		}
+
+		/* A fresh buffer needs the whole crtc painted */
+		sna_crtc->back = bo;
+		RegionUninit(&sna_crtc->back_damage);
+		sna_crtc->back_damage.extents = crtc->bounds;
+		sna_crtc->back_damage.data = NULL;
+		if (sna_crtc->back_damage.extents.x1 < 0)
+			sna_crtc->back_damage.extents.x1 = 0;
+		if (sna_crtc->back_damage.extents.y1 < 0)
+			sna_crtc->back_damage.extents.y1 = 0;
+		if (sna_crtc->back_damage.extents.x2 > sna->front->drawable.width)
+			sna_crtc->back_damage.extents.x2 = sna->front->drawable.width;
+		if (sna_crtc->back_damage.extents.y2 > sna->front->drawable.height)
+			sna_crtc->back_damage.extents.y2 = sna->front->drawable.height;
+	}
+
+	/* The back buffer was last brought up to date the frame before
+	 * the one now being displayed, so it is missing both the damage
+	 * from that frame and from this one.
+	 */
+	RegionUnion(&sna_crtc->back_damage, &sna_crtc->back_damage, region);
+	DBG(("%s: crtc %d, repainting (%d, %d), (%d, %d) x %d into back buffer\n",
+	     __FUNCTION__, sna_crtc->id,
+	     sna_crtc->back_damage.extents.x1, sna_crtc->back_damage.extents.y1,
+	     sna_crtc->back_damage.extents.x2, sna_crtc->back_damage.extents.y2,
+	     REGION_NUM_RECTS(&sna_crtc->back_damage)));
+
+	sna_crtc_redisplay(crtc, &sna_crtc->back_damage, sna_crtc->back);
+	sna->mode.shadow_bytes +=
+		region_bytes(&sna_crtc->back_damage, sna->scrn->bitsPerPixel);
+	kgem_bo_submit(&sna->kgem, sna_crtc->back);
+
+	arg.crtc_id = sna_crtc->id;
+	arg.fb_id = fb_id(sna_crtc->back);
+	arg.user_data = 0;
+	arg.flags = DRM_MODE_PAGE_FLIP_EVENT;
+	arg.reserved = 0;
+	if (drmIoctl(sna->kgem.fd, DRM_IOCTL_MODE_PAGE_FLIP, &arg)) {
+		DBG(("%s: flip [fb=%d] on crtc %d [pipe=%d] failed - %d\n",
+		     __FUNCTION__, arg.fb_id, sna_crtc->id, sna_crtc->pipe, errno));
+		/* Both buffers will be complete once the caller
+		 * repaints the damage into the scanout.
+		 */
+		RegionEmpty(&sna_crtc->back_damage);
+		return false;
+	}
+	sna->mode.shadow_flip++;
+
+	bo = sna_crtc->bo;
+	sna_crtc->bo = sna_crtc->back;
+	sna_crtc->back = bo;
+
+	RegionCopy(&sna_crtc->back_damage, region);
+	return true;
 }
 
 void sna_mode_redisplay(struct sna *sna)
 {
 	xf86CrtcConfigPtr config = XF86_CRTC_CONFIG_PTR(sna->scrn);
+	struct kgem_bo *new, *old;
 	RegionPtr region;
 	int i;
 
@@ -3162,6 +3270,16 @@ void sna_mode_redisplay(struct sna *sna)
 	if (!RegionNotEmpty(region))
 		return;
 
+	/* Let the damage accumulate until the previous tear-free flips
+	 * have landed; the buffers they replaced are still being scanned
+	 * out and cannot be updated until then.
+	 */
+	if (sna->mode.shadow_flip) {
+		DBG(("%s: %d flips still pending\n",
+		     __FUNCTION__, sna->mode.shadow_flip));
+		return;
+	}
+
 	if (!sna_pixmap_move_to_gpu(sna->front, MOVE_READ)) {
 		if (!sna_pixmap_move_to_cpu(sna->front, MOVE_READ))
 			return;
@@ -3180,11 +3298,22 @@ void sna_mode_redisplay(struct sna *sna)
 			damage.extents = crtc->bounds;
 			damage.data = NULL;
 			RegionIntersect(&damage, &damage, region);
-			if (RegionNotEmpty(&damage))
-				sna_crtc_redisplay__fallback(crtc, &damage);
+			if (RegionNotEmpty(&damage)) {
+				sna_crtc_redisplay__fallback(crtc, &damage,
+							     sna_crtc->bo);
+				sna->mode.shadow_bytes +=
+					region_bytes(&damage, sna->scrn->bitsPerPixel);
+
+				/* The back buffer now also lacks this damage */
+				if (sna_crtc->back)
+					RegionUnion(&sna_crtc->back_damage,
+						    &sna_crtc->back_damage,
+						    &damage);
+			}
 			RegionUninit(&damage);
 		}
 
+		sna->mode.shadow_frames++;
 		RegionEmpty(region);
 		return;
 	}
@@ -3203,82 +3332,102 @@ void sna_mode_redisplay(struct sna *sna)
 		damage.extents = crtc->bounds;
 		damage.data = NULL;
 		RegionIntersect(&damage, &damage, region);
-		if (RegionNotEmpty(&damage)) {
-			sna_crtc_redisplay(crtc, &damage);
+		if (RegionNotEmpty(&damage) &&
+		    !(sna->flags & SNA_TEAR_FREE &&
+		      sna_crtc_redisplay__flip(crtc, &damage))) {
+			sna_crtc_redisplay(crtc, &damage, sna_crtc->bo);
+			sna->mode.shadow_bytes +=
+				region_bytes(&damage, sna->scrn->bitsPerPixel);
 			__kgem_flush(&sna->kgem, sna_crtc->bo);
 		}
 		RegionUninit(&damage);
 	}
 
+	sna->mode.shadow_frames++;
 	if (!sna->mode.shadow) {
 		kgem_submit(&sna->kgem);
 		RegionEmpty(region);
 		return;
 	}
 
-	if (sna->mode.shadow_flip == 0) {
-		struct kgem_bo *new = sna_pixmap_get_bo(sna->front);
-		struct kgem_bo *old = sna->mode.shadow;
+	new = sna_pixmap_get_bo(sna->front);
+	old = sna->mode.shadow;
 
-		DBG(("%s: flipping tear-free outputs\n", __FUNCTION__));
-		kgem_bo_submit(&sna->kgem, new);
+	DBG(("%s: flipping tear-free outputs\n", __FUNCTION__));
+	kgem_bo_submit(&sna->kgem, new);
 
-		for (i = 0; i < config->num_crtc; i++) {
-			struct sna_crtc *crtc = config->crtc[i]->driver_private;
-			struct drm_mode_crtc_page_flip arg;
+	for (i = 0; i < config->num_crtc; i++) {
+		struct sna_crtc *crtc = config->crtc[i]->driver_private;
+		struct drm_mode_crtc_page_flip arg;
 
-			DBG(("%s: crtc %d [%d, pipe=%d] active? %d\n",
-			     __FUNCTION__, i, crtc->id, crtc->pipe, crtc->bo != NULL));
-			if (crtc->bo != old)
-				continue;
+		DBG(("%s: crtc %d [%d, pipe=%d] active? %d\n",
+		     __FUNCTION__, i, crtc->id, crtc->pipe, crtc->bo != NULL));
+		if (crtc->bo != old)
+			continue;
 
-			assert(config->crtc[i]->enabled);
-			assert(crtc->dpms_mode == DPMSModeOn);
+		assert(config->crtc[i]->enabled);
+		assert(crtc->dpms_mode == DPMSModeOn);
 
-			arg.crtc_id = crtc->id;
-			arg.fb_id = get_fb(sna, new,
-					   sna->scrn->virtualX,
-					   sna->scrn->virtualY);
-			if (arg.fb_id == 0)
-				goto disable;
+		arg.crtc_id = crtc->id;
+		arg.fb_id = get_fb(sna, new,
+				   sna->scrn->virtualX,
+				   sna->scrn->virtualY);
+		if (arg.fb_id == 0)
+			goto disable;
 
-			arg.user_data = 0;
-			arg.flags = DRM_MODE_PAGE_FLIP_EVENT;
-			arg.reserved = 0;
+		arg.user_data = 0;
+		arg.flags = DRM_MODE_PAGE_FLIP_EVENT;
+		arg.reserved = 0;
 
-			if (drmIoctl(sna->kgem.fd, DRM_IOCTL_MODE_PAGE_FLIP, &arg)) {
-				DBG(("%s: flip [fb=%d] on crtc %d [%d, pipe=%d] failed - %d\n",
-				     __FUNCTION__, arg.fb_id, i, crtc->id, crtc->pipe, errno));
+		if (drmIoctl(sna->kgem.fd, DRM_IOCTL_MODE_PAGE_FLIP, &arg)) {
+			DBG(("%s: flip [fb=%d] on crtc %d [%d, pipe=%d] failed - %d\n",
+			     __FUNCTION__, arg.fb_id, i, crtc->id, crtc->pipe, errno));
 disable:
-				sna_crtc_disable(config->crtc[i]);
-				continue;
-			}
-			sna->mode.shadow_flip++;
-
-			kgem_bo_destroy(&sna->kgem, old);
-			crtc->bo = kgem_bo_reference(new);
+			sna_crtc_disable(config->crtc[i]);
+			continue;
 		}
+		sna->mode.shadow_flip++;
 
-		if (sna->mode.shadow) {
-			while (sna->mode.shadow_flip)
-				sna_mode_wakeup(sna);
-			(void)sna->render.copy_boxes(sna, GXcopy,
-						     sna->front, new, 0, 0,
-						     sna->front, old, 0, 0,
-						     REGION_RECTS(region),
-						     REGION_NUM_RECTS(region),
-						     COPY_LAST);
-			kgem_submit(&sna->kgem);
-
-			sna_pixmap(sna->front)->gpu_bo = old;
-			sna_dri_pixmap_update_bo(sna, sna->front);
-
-			sna->mode.shadow = new;
-			new->flush = old->flush;
-		}
+		kgem_bo_destroy(&sna->kgem, old);
+		crtc->bo = kgem_bo_reference(new);
+	}
 
-		RegionEmpty(region);
+	if (sna->mode.shadow) {
+		while (sna->mode.shadow_flip)
+			sna_mode_wakeup(sna);
+		(void)sna->render.copy_boxes(sna, GXcopy,
+					     sna->front, new, 0, 0,
+					     sna->front, old, 0, 0,
+					     REGION_RECTS(region),
+					     REGION_NUM_RECTS(region),
+					     COPY_LAST);
+		sna->mode.shadow_bytes +=
+			region_bytes(region, sna->front->drawable.bitsPerPixel);
+		kgem_submit(&sna->kgem);
+
+		sna_pixmap(sna->front)->gpu_bo = old;
+		sna_dri_pixmap_update_bo(sna, sna->front);
+
+		sna->mode.shadow = new;
+		new->flush = old->flush;
 	}
+
+	RegionEmpty(region);
+}
+
+void sna_mode_report_stats(struct sna *sna)
+{
+	if (sna->mode.shadow_frames == 0)
+		return;
+
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Shadow updates: %u frames, %lluKiB copied, average %llu bytes per frame\n",
+		   sna->mode.shadow_frames,
+		   (unsigned long long)(sna->mode.shadow_bytes >> 10),
+		   (unsigned long long)(sna->mode.shadow_bytes / sna->mode.shadow_frames));
+
+	sna->mode.shadow_frames = 0;
+	sna->mode.shadow_bytes = 0;
 }
 
 void sna_mode_wakeup(struct sna *sna)
@@ -56,6 +56,7 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define COLOR_PREFER_TILING_Y 0
 #define FLIP_OFF_DELAY 5
+#define SWAP_LATENCY_BINS 8
 
 enum frame_event_type {
 	DRI2_SWAP,
@@ -91,9 +92,26 @@ struct sna_dri_frame_event {
 	struct dri_bo {
 		struct kgem_bo *bo;
 		uint32_t name;
-	} old_front, next_front, cache;
+	} old_front, next_front, cache, queued;
 
 	int off_delay;
+
+	/* for accounting */
+	CARD32 swap_time;
+	unsigned int target_msc;
+};
+
+struct sna_dri_stats {
+	struct list link;
+	XID drawable;
+
+	unsigned int flips;
+	unsigned int exchanges;
+	unsigned int blits;
+	unsigned int missed;
+
+	/* swap request to completion, in powers of two milliseconds */
+	unsigned int latency[SWAP_LATENCY_BINS];
 };
 
 struct sna_dri_private {
@@ -923,9 +941,114 @@ sna_dri_remove_frame_event(WindowPtr win,
 	chain->chain = info->chain;
 }
 
+static struct sna_dri_stats *
+sna_dri_window_get_stats(WindowPtr win)
+{
+	return ((void **)dixGetPrivateAddr(&win->devPrivates, &sna_window_key))[2];
+}
+
+static void
+sna_dri_window_set_stats(WindowPtr win, struct sna_dri_stats *stats)
+{
+	((void **)dixGetPrivateAddr(&win->devPrivates, &sna_window_key))[2] = stats;
+}
+
+static void
+sna_dri_report_window_stats(struct sna *sna,
+			    const struct sna_dri_stats *stats)
+{
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "DRI2 drawable 0x%lx (client %d): %u flips, %u exchanges, %u blits, %u missed vblanks; latency/ms <1:%u 1:%u 2-3:%u 4-7:%u 8-15:%u 16-31:%u 32-63:%u 64+:%u\n",
+		   (long)stats->drawable, (int)CLIENT_ID(stats->drawable),
+		   stats->flips, stats->exchanges, stats->blits, stats->missed,
+		   stats->latency[0], stats->latency[1],
+		   stats->latency[2], stats->latency[3],
+		   stats->latency[4], stats->latency[5],
+		   stats->latency[6], stats->latency[7]);
+}
+
+/* Record how the swap was completed, so that we can find which clients
+ * fall off the flip path.
+ */
+static void
+sna_dri_record_swap(struct sna *sna, DrawablePtr draw,
+		    const struct sna_dri_frame_event *info,
+		    int type, unsigned int frame)
+{
+	struct sna_dri_stats *stats;
+	CARD32 latency;
+	int bin;
+
+	if (draw == NULL || draw->type != DRAWABLE_WINDOW)
+		return;
+
+	stats = sna_dri_window_get_stats((WindowPtr)draw);
+	if (stats == NULL) {
+		stats = calloc(1, sizeof(*stats));
+		if (stats == NULL)
+			return;
+
+		stats->drawable = draw->id;
+		list_add(&stats->link, &sna->dri.stats);
+		sna_dri_window_set_stats((WindowPtr)draw, stats);
+	}
+
+	switch (type) {
+	case DRI2_FLIP_COMPLETE:
+		stats->flips++;
+		break;
+	case DRI2_EXCHANGE_COMPLETE:
+		stats->exchanges++;
+		break;
+	default:
+		stats->blits++;
+		break;
+	}
+
+	if (info == NULL) {
+		stats->latency[0]++;
+		return;
+	}
+
+	if (info->target_msc && frame && (int)(frame - info->target_msc) > 0) {
+		DBG(("%s: missed target frame %d, presented at %d\n",
+		     __FUNCTION__, info->target_msc, frame));
+		stats->missed++;
+	}
+
+	latency = GetTimeInMillis() - info->swap_time;
+	for (bin = 0; bin < SWAP_LATENCY_BINS - 1 && latency; bin++)
+		latency >>= 1;
+	stats->latency[bin]++;
+}
+
+void sna_dri_report_stats(struct sna *sna)
+{
+	struct sna_dri_stats *stats;
+
+	if (!sna->dri_open)
+		return;
+
+	list_for_each_entry(stats, &sna->dri.stats, link)
+		sna_dri_report_window_stats(sna, stats);
+}
+
 void sna_dri_destroy_window(WindowPtr win)
 {
 	struct sna_dri_frame_event *chain;
+	struct sna_dri_stats *stats;
+
+	stats = sna_dri_window_get_stats(win);
+	if (stats) {
+		struct sna *sna = to_sna_from_drawable(&win->drawable);
+
+		if (sna->flags & SNA_REPORT_STATS)
+			sna_dri_report_window_stats(sna, stats);
+
+		list_del(&stats->link);
+		free(stats);
+		sna_dri_window_set_stats(win, NULL);
+	}
 
 	chain = sna_dri_window_get_chain(win);
 	if (chain == NULL)
@@ -979,6 +1102,9 @@ sna_dri_frame_event_info_free(struct sna *sna,
 	if (info->cache.bo)
 		kgem_bo_destroy(&sna->kgem, info->cache.bo);
 
+	if (info->queued.bo)
+		kgem_bo_destroy(&sna->kgem, info->queued.bo);
+
 	if (info->bo)
 		kgem_bo_destroy(&sna->kgem, info->bo);
 
@@ -1246,6 +1372,7 @@ static void chain_swap(struct sna *sna,
 		type = DRI2_BLIT_COMPLETE;
 	}
 
+	sna_dri_record_swap(sna, draw, chain, type, event->sequence);
 	DRI2SwapComplete(chain->client, draw,
 			 event->sequence, event->tv_sec, event->tv_usec,
 			 type, chain->client ? chain->event_complete : NULL, chain->event_data);
@@ -1318,6 +1445,7 @@ void sna_dri_vblank_handler(struct sna *sna, struct drm_event_vblank *event)
 		if (!sna_dri_blit_complete(sna, info))
 			return;
 
+		sna_dri_record_swap(sna, draw, info, DRI2_BLIT_COMPLETE, event->sequence);
 		DRI2SwapComplete(info->client,
 				 draw, event->sequence,
 				 event->tv_sec, event->tv_usec,
@@ -1378,6 +1506,77 @@ sna_dri_flip_continue(struct sna *sna, struct sna_dri_frame_event *info)
 	info->next_front.name = 0;
 }
 
+/* Triple buffering: take the freshly rendered back buffer and queue it
+ * for the next flip, handing the client a spare buffer to render the
+ * following frame into whilst the current flip is still pending.
+ */
+static bool
+sna_dri_flip_queue(struct sna *sna, struct sna_dri_frame_event *info)
+{
+	struct kgem_bo *bo;
+	uint32_t name;
+
+	assert(info->queued.bo == NULL);
+
+	if (info->cache.bo) {
+		bo = info->cache.bo;
+		name = info->cache.name;
+		info->cache.bo = NULL;
+	} else {
+		bo = kgem_create_2d(&sna->kgem,
+				    info->draw->width,
+				    info->draw->height,
+				    info->draw->bitsPerPixel,
+				    get_private(info->front)->bo->tiling,
+				    CREATE_SCANOUT | CREATE_EXACT);
+		if (bo == NULL)
+			return false;
+
+		name = kgem_bo_flink(&sna->kgem, bo);
+		if (name == 0) {
+			kgem_bo_destroy(&sna->kgem, bo);
+			return false;
+		}
+	}
+
+	DBG(("%s: queueing handle=%d, spare back handle=%d\n",
+	     __FUNCTION__, get_private(info->back)->bo->handle, bo->handle));
+
+	info->queued.bo = get_private(info->back)->bo;
+	info->queued.name = info->back->name;
+
+	get_private(info->back)->bo = bo;
+	info->back->name = name;
+	return true;
+}
+
+static void
+sna_dri_flip_queued(struct sna *sna, struct sna_dri_frame_event *info)
+{
+	DBG(("%s: flipping to queued handle=%d\n",
+	     __FUNCTION__, info->queued.bo->handle));
+
+	assert(sna_pixmap_get_buffer(get_drawable_pixmap(info->draw)) == info->front);
+
+	/* The previous scanout is no longer in use, keep it as our spare */
+	if (info->cache.bo)
+		kgem_bo_destroy(&sna->kgem, info->cache.bo);
+	info->cache = info->old_front;
+
+	info->count = sna_page_flip(sna, info->queued.bo, info, info->pipe);
+
+	info->old_front.name = info->front->name;
+	info->old_front.bo = get_private(info->front)->bo;
+
+	set_bo(sna->front, info->queued.bo);
+
+	info->front->name = info->queued.name;
+	get_private(info->front)->bo = info->queued.bo;
+
+	info->queued.bo = NULL;
+	info->queued.name = 0;
+}
+
 static void chain_flip(struct sna *sna)
 {
 	struct sna_dri_frame_event *chain = sna->dri.flip_pending;
@@ -1402,6 +1601,7 @@ static void chain_flip(struct sna *sna)
 		chain->old_front.bo = NULL;
 
 		if (chain->count == 0) {
+			sna_dri_record_swap(sna, chain->draw, chain, DRI2_FLIP_COMPLETE, 0);
 			DRI2SwapComplete(chain->client, chain->draw, 0, 0, 0,
 					 DRI2_EXCHANGE_COMPLETE,
 					 chain->event_complete,
@@ -1416,12 +1616,47 @@ static void chain_flip(struct sna *sna)
 						  get_private(chain->front)->bo,
 						  get_private(chain->back)->bo,
 						  true);
+		sna_dri_record_swap(sna, chain->draw, chain, DRI2_BLIT_COMPLETE, 0);
 		DRI2SwapComplete(chain->client, chain->draw, 0, 0, 0,
 				 DRI2_BLIT_COMPLETE, chain->client ? chain->event_complete : NULL, chain->event_data);
 		sna_dri_frame_event_info_free(sna, chain->draw, chain);
 	}
 }
 
+/* We can no longer flip to the queued frame, so copy it to the front
+ * instead. If a client is blocked behind it, its back buffer already
+ * holds a newer frame which supersedes the queued one, so copy that
+ * and complete its swap as a blit.
+ */
+static void sna_dri_flip_copy_queued(struct sna *sna,
+				     struct sna_dri_frame_event *flip)
+{
+	DBG(("%s: copying %s frame\n", __FUNCTION__,
+	     flip->next_front.name ? "pending" : "queued"));
+
+	if (flip->draw == NULL)
+		return;
+
+	if (flip->bo)
+		kgem_bo_destroy(&sna->kgem, flip->bo);
+	flip->bo = sna_dri_copy_to_front(sna, flip->draw, NULL,
+					 get_private(flip->front)->bo,
+					 flip->next_front.name ?
+					 get_private(flip->back)->bo :
+					 flip->queued.bo,
+					 false);
+
+	if (flip->next_front.name) {
+		flip->next_front.name = 0;
+		sna_dri_record_swap(sna, flip->draw, flip, DRI2_BLIT_COMPLETE, 0);
+		DRI2SwapComplete(flip->client, flip->draw,
+				 0, 0, 0,
+				 DRI2_BLIT_COMPLETE,
+				 flip->client ? flip->event_complete : NULL,
+				 flip->event_data);
+	}
+}
+
 static void sna_dri_flip_event(struct sna *sna,
 			       struct sna_dri_frame_event *flip)
 {
@@ -1440,7 +1675,9 @@ static void sna_dri_flip_event(struct sna *sna,
 	case DRI2_FLIP:
 		DBG(("%s: flip complete (drawable gone? %d)\n",
 		     __FUNCTION__, flip->draw == NULL));
-		if (flip->draw)
+		if (flip->draw) {
+			sna_dri_record_swap(sna, flip->draw, flip,
+					    DRI2_FLIP_COMPLETE, flip->fe_frame);
 			DRI2SwapComplete(flip->client, flip->draw,
 					 flip->fe_frame,
 					 flip->fe_tv_sec,
@@ -1448,6 +1685,7 @@ static void sna_dri_flip_event(struct sna *sna,
 					 DRI2_FLIP_COMPLETE,
 					 flip->client ? flip->event_complete : NULL,
 					 flip->event_data);
+		}
 
 		sna_dri_frame_event_info_free(sna, flip->draw, flip);
 
@@ -1457,8 +1695,40 @@ static void sna_dri_flip_event(struct sna *sna,
 
 	case DRI2_FLIP_THROTTLE:
 		if (sna->dri.flip_pending) {
+			/* The client was told its queued frame was swapped,
+			 * so it must reach the front before we stop.
+			 */
+			if (flip->queued.bo)
+				sna_dri_flip_copy_queued(sna, flip);
 			sna_dri_frame_event_info_free(sna, flip->draw, flip);
 			chain_flip(sna);
+		} else if (flip->queued.bo && flip->draw &&
+			   can_flip(sna, flip->draw, flip->front, flip->back)) {
+			sna_dri_flip_queued(sna, flip);
+
+			/* A client blocked behind the queued frame can
+			 * now take its place.
+			 */
+			if (flip->next_front.name &&
+			    sna_dri_flip_queue(sna, flip)) {
+				flip->next_front.name = 0;
+				sna_dri_record_swap(sna, flip->draw, flip, DRI2_FLIP_COMPLETE, 0);
+				DRI2SwapComplete(flip->client, flip->draw,
+						 0, 0, 0,
+						 DRI2_EXCHANGE_COMPLETE,
+						 flip->client ? flip->event_complete : NULL,
+						 flip->event_data);
+			}
+
+			if (flip->count) {
+				sna->dri.flip_pending = flip;
+				flip->off_delay = FLIP_OFF_DELAY;
+			} else
+				sna_dri_frame_event_info_free(sna, flip->draw, flip);
+		} else if (flip->queued.bo) {
+			DBG(("%s: no longer able to flip\n", __FUNCTION__));
+			sna_dri_flip_copy_queued(sna, flip);
+			sna_dri_frame_event_info_free(sna, flip->draw, flip);
 		} else if (!flip->next_front.name) {
 			/* Keep the pageflipping running for a couple of frames
 			 * so we keep the uncached scanouts alive.
@@ -1479,16 +1749,17 @@ static void sna_dri_flip_event(struct sna *sna,
 		} else if (flip->draw &&
 			   can_flip(sna, flip->draw, flip->front, flip->back)) {
 			sna_dri_flip_continue(sna, flip);
+			sna_dri_record_swap(sna, flip->draw, flip, DRI2_FLIP_COMPLETE, 0);
 			DRI2SwapComplete(flip->client, flip->draw,
 					 0, 0, 0,
 					 DRI2_FLIP_COMPLETE,
 					 flip->client ? flip->event_complete : NULL,
 					 flip->event_data);
-			if (flip->count)
+			if (flip->count) {
 				sna->dri.flip_pending = flip;
-			else
+				flip->off_delay = FLIP_OFF_DELAY;
+			} else
 				sna_dri_frame_event_info_free(sna, flip->draw, flip);
-			flip->off_delay = FLIP_OFF_DELAY;
 		} else {
 			DBG(("%s: no longer able to flip\n", __FUNCTION__));
 
@@ -1497,6 +1768,7 @@ static void sna_dri_flip_event(struct sna *sna,
 								 get_private(flip->front)->bo,
 								 get_private(flip->back)->bo,
 								 false);
+				sna_dri_record_swap(sna, flip->draw, flip, DRI2_BLIT_COMPLETE, 0);
 				DRI2SwapComplete(flip->client, flip->draw,
 						 0, 0, 0,
 						 DRI2_BLIT_COMPLETE,
@@ -1614,6 +1886,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 		/* XXX WARN_ON(sna->dri.flip_pending) ? */
 		if (sna->dri.flip_pending == NULL) {
 			sna_dri_exchange_buffers(draw, front, back);
+			sna_dri_record_swap(sna, draw, NULL, DRI2_EXCHANGE_COMPLETE, 0);
 			DRI2SwapComplete(client, draw, 0, 0, 0,
 					DRI2_EXCHANGE_COMPLETE, func, data);
 			return true;
@@ -1630,6 +1903,18 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 
 		info = sna->dri.flip_pending;
 		if (info && info->draw == draw && info->type == DRI2_FLIP_THROTTLE) {
+			info->swap_time = GetTimeInMillis();
+
+			if (sna->flags & SNA_TRIPLE_BUFFER &&
+			    info->queued.bo == NULL &&
+			    sna_dri_flip_queue(sna, info)) {
+				DBG(("%s: queueing flip\n", __FUNCTION__));
+				sna_dri_record_swap(sna, draw, info, DRI2_FLIP_COMPLETE, 0);
+				DRI2SwapComplete(client, draw, 0, 0, 0,
+						 DRI2_EXCHANGE_COMPLETE, func, data);
+				return true;
+			}
+
 			DBG(("%s: chaining flip\n", __FUNCTION__));
 			info->next_front.name = 1;
 			return true;
@@ -1640,6 +1925,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 			return false;
 
 		info->type = DRI2_FLIP_THROTTLE;
+		info->swap_time = GetTimeInMillis();
 
 		info->draw = draw;
 		info->client = client;
@@ -1672,6 +1958,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 			get_private(info->back)->bo = info->old_front.bo;
 			info->old_front.bo = NULL;
 
+			sna_dri_record_swap(sna, draw, info, DRI2_EXCHANGE_COMPLETE, 0);
 			DRI2SwapComplete(info->client, draw, 0, 0, 0,
 					 DRI2_EXCHANGE_COMPLETE,
 					 info->event_complete,
@@ -1690,6 +1977,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 			info->off_delay = FLIP_OFF_DELAY;
 			sna->dri.flip_pending = info;
 
+			sna_dri_record_swap(sna, draw, info, DRI2_FLIP_COMPLETE, 0);
 			DRI2SwapComplete(info->client, draw, 0, 0, 0,
 					 DRI2_EXCHANGE_COMPLETE,
 					 info->event_complete,
@@ -1712,6 +2000,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 		info->back = back;
 		info->pipe = pipe;
 		info->type = DRI2_FLIP;
+		info->swap_time = GetTimeInMillis();
 
 		sna_dri_add_frame_event(draw, info);
 		sna_dri_reference_buffer(front);
@@ -1774,6 +2063,7 @@ sna_dri_schedule_flip(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 		}
 
 		/* Account for 1 frame extra pageflip delay */
+		info->target_msc = vbl.request.sequence;
 		vbl.request.sequence -= 1;
 		vbl.request.signal = (unsigned long)info;
 		if (sna_wait_vblank(sna, &vbl)) {
@@ -1803,6 +2093,7 @@ sna_dri_immediate_xchg(struct sna *sna,
 			     __FUNCTION__));
 
 			sna_dri_exchange_buffers(draw, info->front, info->back);
+			sna_dri_record_swap(sna, draw, info, DRI2_EXCHANGE_COMPLETE, 0);
 			DRI2SwapComplete(info->client, draw, 0, 0, 0,
 					 DRI2_EXCHANGE_COMPLETE,
 					 info->event_complete,
@@ -1819,6 +2110,7 @@ sna_dri_immediate_xchg(struct sna *sna,
 		}
 	} else {
 		sna_dri_exchange_buffers(draw, info->front, info->back);
+		sna_dri_record_swap(sna, draw, info, DRI2_EXCHANGE_COMPLETE, 0);
 		DRI2SwapComplete(info->client, draw, 0, 0, 0,
 				 DRI2_EXCHANGE_COMPLETE,
 				 info->event_complete,
@@ -1847,6 +2139,7 @@ sna_dri_immediate_blit(struct sna *sna,
 							 get_private(info->front)->bo,
 							 get_private(info->back)->bo,
 							 true);
+			sna_dri_record_swap(sna, draw, info, DRI2_BLIT_COMPLETE, 0);
 			DRI2SwapComplete(info->client, draw, 0, 0, 0,
 					 DRI2_BLIT_COMPLETE,
 					 info->event_complete,
@@ -1867,6 +2160,7 @@ sna_dri_immediate_blit(struct sna *sna,
 						 get_private(info->front)->bo,
 						 get_private(info->back)->bo,
 						 false);
+		sna_dri_record_swap(sna, draw, info, DRI2_BLIT_COMPLETE, 0);
 		DRI2SwapComplete(info->client, draw, 0, 0, 0,
 				 DRI2_BLIT_COMPLETE,
 				 info->event_complete,
@@ -1930,6 +2224,7 @@ sna_dri_schedule_swap(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 			DBG(("%s: unattached, exchange pixmaps\n", __FUNCTION__));
 			sna_dri_exchange_buffers(draw, front, back);
 
+			sna_dri_record_swap(sna, draw, NULL, DRI2_EXCHANGE_COMPLETE, 0);
 			DRI2SwapComplete(client, draw, 0, 0, 0,
 					 DRI2_EXCHANGE_COMPLETE, func, data);
 			return TRUE;
@@ -1958,6 +2253,7 @@ sna_dri_schedule_swap(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 	info->front = front;
 	info->back = back;
 	info->pipe = pipe;
+	info->swap_time = GetTimeInMillis();
 
 	sna_dri_add_frame_event(draw, info);
 	sna_dri_reference_buffer(front);
@@ -2000,6 +2296,7 @@ sna_dri_schedule_swap(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 			pipe_select(pipe);
 		vbl.request.sequence = *target_msc;
 		vbl.request.signal = (unsigned long)info;
+		info->target_msc = vbl.request.sequence;
 		if (sna_wait_vblank(sna, &vbl))
 			goto blit_fallback;
 
@@ -2036,6 +2333,7 @@ sna_dri_schedule_swap(ClientPtr client, DrawablePtr draw, DRI2BufferPtr front,
 	vbl.request.sequence -= 1;
 
 	vbl.request.signal = (unsigned long)info;
+	info->target_msc = vbl.request.sequence;
 	if (sna_wait_vblank(sna, &vbl))
 		goto blit_fallback;
 
@@ -2057,6 +2355,7 @@ blit_fallback:
 	}
 	if (info)
 		sna_dri_frame_event_info_free(sna, draw, info);
+	sna_dri_record_swap(sna, draw, NULL, pipe, 0);
 	DRI2SwapComplete(client, draw, 0, 0, 0, pipe, func, data);
 	*target_msc = 0; /* offscreen, so zero out target vblank count */
 	return TRUE;
@@ -2090,6 +2389,7 @@ blit:
 			name = DRI2_BLIT_COMPLETE;
 		}
 
+		sna_dri_record_swap(sna, draw, NULL, name, 0);
 		DRI2SwapComplete(client, draw, 0, 0, 0, name, func, data);
 		return name == DRI2_EXCHANGE_COMPLETE;
 	}
@@ -2113,6 +2413,7 @@ blit:
 		info->client = client;
 		info->draw = draw;
 		info->type = DRI2_ASYNC_FLIP;
+		info->swap_time = GetTimeInMillis();
 		info->pipe = pipe;
 		info->front = front;
 		info->back = back;
@@ -2161,6 +2462,7 @@ blit:
 	set_bo(sna->front, get_private(info->front)->bo);
 	sna->dri.flip_pending = info;
 
+	sna_dri_record_swap(sna, draw, NULL, DRI2_FLIP_COMPLETE, 0);
 	DRI2SwapComplete(client, draw, 0, 0, 0,
 			 DRI2_EXCHANGE_COMPLETE, func, data);
 	return TRUE;
@@ -2327,6 +2629,8 @@ bool sna_dri_open(struct sna *sna, ScreenPtr screen)
 
 	DBG(("%s()\n", __FUNCTION__));
 
+	list_init(&sna->dri.stats);
+
 	if (wedged(sna)) {
 		xf86DrvMsg(sna->scrn->scrnIndex, X_WARNING,
 			   "loading DRI2 whilst the GPU is wedged.\n");
@@ -502,10 +502,16 @@ static Bool sna_pre_init(ScrnInfoPtr scrn, int flags)
 	if (has_pageflipping(sna)) {
 		if (xf86ReturnOptValBool(sna->Options, OPTION_TEAR_FREE, FALSE))
 			sna->flags |= SNA_TEAR_FREE;
+		if (xf86ReturnOptValBool(sna->Options, OPTION_TRIPLE_BUFFER, FALSE))
+			sna->flags |= SNA_TRIPLE_BUFFER;
 	} else
 		sna->flags |= SNA_NO_FLIP;
 	if (xf86ReturnOptValBool(sna->Options, OPTION_CRTC_PIXMAPS, FALSE))
 		sna->flags |= SNA_FORCE_SHADOW;
+	if (xf86ReturnOptValBool(sna->Options, OPTION_DEBUG_STATS, FALSE))
+		sna->flags |= SNA_REPORT_STATS;
+	if (xf86ReturnOptValBool(sna->Options, OPTION_DEBUG_PROFILE, FALSE))
+		sna->flags |= SNA_PROFILE;
 
 	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "Framebuffer %s\n",
 		   sna->tiling & SNA_TILING_FB ? "tiled" : "linear");
@@ -519,8 +525,14 @@ static Bool sna_pre_init(ScrnInfoPtr scrn, int flags)
 		   sna->flags & SNA_NO_DELAYED_FLUSH ? "dis" : "en");
 	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "\"Tear free\" %sabled\n",
 		   sna->flags & SNA_TEAR_FREE ? "en" : "dis");
+	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "Triple buffering %sabled\n",
+		   sna->flags & SNA_TRIPLE_BUFFER ? "en" : "dis");
 	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "Forcing per-crtc-pixmaps? %s\n",
 		   sna->flags & SNA_FORCE_SHADOW ? "yes" : "no");
+	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "Reporting statistics? %s\n",
+		   sna->flags & SNA_REPORT_STATS ? "yes" : "no");
+	xf86DrvMsg(scrn->scrnIndex, X_CONFIG, "Profiling requests? %s\n",
+		   sna->flags & SNA_PROFILE ? "yes" : "no");
 
 	if (!sna_mode_pre_init(scrn, sna)) {
 		PreInitCleanup(scrn);
@@ -813,7 +825,7 @@ sna_register_all_privates(void)
 		return FALSE;
 
 	if (!dixRegisterPrivateKey(&sna_window_key, PRIVATE_WINDOW,
-				   2*sizeof(void *)))
+				   3*sizeof(void *)))
 		return FALSE;
 
 	return TRUE;
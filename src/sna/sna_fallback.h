@@ -0,0 +1,44 @@
+#ifndef SNA_FALLBACK_H
+#define SNA_FALLBACK_H
+
+#include <stdint.h>
+
+/*
+ * Accounting of software fallbacks. Whenever we decide that an
+ * operation cannot be accelerated, we note the reason with
+ * sna_fallback_reason() before jumping to the fallback path; the
+ * fallback path then records it along with the number of pixels
+ * affected (see sna_fallback_record() in sna.h). Fallbacks taken
+ * without an explicit reason are those where the GPU path was
+ * attempted but declined the operation.
+ *
+ * The table is always maintained and reported with Option "DebugStats"
+ * and upon SIGUSR2 (see sna_accel.c).
+ */
+
+enum sna_fallback_reason {
+	FALLBACK_DECLINED = 0,	/* GPU path was tried but declined */
+	FALLBACK_WEDGED,	/* the GPU is hung */
+	FALLBACK_UNATTACHED,	/* the pixmap has no GPU private */
+	FALLBACK_CPU,		/* the pixmap is better left on the CPU */
+	FALLBACK_MIGRATE,	/* unable to move the pixmap to/from the GPU */
+	FALLBACK_TILING,	/* unable to change to a tiling the BLT handles */
+	FALLBACK_PLANEMASK,	/* non-solid planemask */
+	FALLBACK_FILL,		/* fill style unsupported by this path */
+	FALLBACK_LINE,		/* wide or dashed lines/arcs */
+	FALLBACK_FONT,		/* glyphs too large for the BLT path */
+	FALLBACK_ALPHA_MAP,	/* destination has an alpha map */
+	FALLBACK_RENDER,	/* render backend rejected the operation */
+	FALLBACK_SPANS,		/* no span rasteriser for the operation */
+	FALLBACK_NUM_REASONS
+};
+
+struct sna_fallback_stats {
+	struct sna_fallback_counter {
+		uint64_t count;
+		uint64_t pixels;
+	} reason[FALLBACK_NUM_REASONS];
+	enum sna_fallback_reason pending;
+};
+
+#endif /* SNA_FALLBACK_H */
@@ -1318,8 +1318,12 @@ glyphs_fallback(CARD8 op,
 
 	glyph_extents(nlist, list, glyphs, &region.extents);
 	if (region.extents.x2 <= region.extents.x1 ||
-	    region.extents.y2 <= region.extents.y1)
+	    region.extents.y2 <= region.extents.y1) {
+		sna_fallback_clear(sna);
 		return;
+	}
+
+	sna_fallback_record(sna, &region.extents);
 
 	DBG(("%s: (%d, %d), (%d, %d)\n", __FUNCTION__,
 	     region.extents.x1, region.extents.y1,
@@ -1639,17 +1643,20 @@ sna_glyphs(CARD8 op,
 
 	if (!can_render(sna)) {
 		DBG(("%s: wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	if (dst->alphaMap) {
 		DBG(("%s: fallback -- dst alpha map\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_ALPHA_MAP);
 		goto fallback;
 	}
 
 	priv = sna_pixmap(pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- destination unattached\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -1657,6 +1664,7 @@ sna_glyphs(CARD8 op,
 	    !picture_is_gpu(src)) {
 		DBG(("%s: fallback -- too small (%dx%d)\n",
 		     __FUNCTION__, dst->pDrawable->width, dst->pDrawable->height));
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
 	}
 
@@ -1961,17 +1969,20 @@ sna_glyphs__shared(CARD8 op,
 
 	if (!can_render(sna)) {
 		DBG(("%s: wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	if (dst->alphaMap) {
 		DBG(("%s: fallback -- dst alpha map\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_ALPHA_MAP);
 		goto fallback;
 	}
 
 	priv = sna_pixmap(pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- destination unattached\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -1979,6 +1990,7 @@ sna_glyphs__shared(CARD8 op,
 	    !picture_is_gpu(src)) {
 		DBG(("%s: fallback -- too small (%dx%d)\n",
 		     __FUNCTION__, dst->pDrawable->width, dst->pDrawable->height));
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
 	}
 
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2012 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <strings.h>
+
+#include "sna_migrate.h"
+
+static const char *op_names[MIGRATE_NUM_OPS] = {
+	[MIGRATE_MOVE_TO_CPU] = "move-to-cpu",
+	[MIGRATE_MOVE_REGION_TO_CPU] = "move-region-to-cpu",
+	[MIGRATE_MOVE_TO_GPU] = "move-to-gpu",
+	[MIGRATE_MOVE_AREA_TO_GPU] = "move-area-to-gpu",
+	[MIGRATE_USE_BO] = "use-bo",
+};
+
+static const char *dir_names[2] = {
+	[MIGRATE_TO_CPU] = "cpu",
+	[MIGRATE_TO_GPU] = "gpu",
+};
+
+const char *sna_migrate_op_name(unsigned op)
+{
+	return op < MIGRATE_NUM_OPS ? op_names[op] : "unknown";
+}
+
+/* The historical behaviour: migrate whenever the heuristics ask */
+static bool
+greedy_allow(const struct sna_migrate_policy *policy,
+	     const struct sna_migrate_history *history,
+	     const struct sna_migration *m)
+{
+	return true;
+}
+
+const struct sna_migrate_policy sna_migrate_greedy = {
+	"greedy", 0, greedy_allow
+};
+
+/* Refuse to move a pixmap back to the domain it has just left. The
+ * window over which we hold the pixmap in place grows each time it is
+ * caught bouncing between the CPU and GPU, and shrinks again once it
+ * settles.
+ */
+static bool
+hysteresis_allow(const struct sna_migrate_policy *policy,
+		 const struct sna_migrate_history *history,
+		 const struct sna_migration *m)
+{
+	uint32_t window;
+
+	if (!history->valid || history->dir == m->dir)
+		return true;
+
+	window = policy->window * (1 + history->reversals);
+	return m->time - history->time >= window;
+}
+
+const struct sna_migrate_policy sna_migrate_hysteresis = {
+	"hysteresis", 100, hysteresis_allow
+};
+
+const struct sna_migrate_policy *sna_migrate_policy_lookup(const char *name)
+{
+	static const struct sna_migrate_policy *policies[] = {
+		&sna_migrate_greedy,
+		&sna_migrate_hysteresis,
+	};
+	unsigned n;
+
+	for (n = 0; n < sizeof(policies)/sizeof(policies[0]); n++)
+		if (strcasecmp(name, policies[n]->name) == 0)
+			return policies[n];
+
+	return NULL;
+}
+
+bool sna_migrate_decide(const struct sna_migrate_policy *policy,
+			const struct sna_migrate_history *history,
+			struct sna_migration *m)
+{
+	m->allowed = !m->optional || policy->allow(policy, history, m);
+	return m->allowed;
+}
+
+void sna_migrate_update(const struct sna_migrate_policy *policy,
+			struct sna_migrate_history *history,
+			const struct sna_migration *m)
+{
+	uint32_t window = policy->window ?: 100;
+
+	if (history->valid) {
+		if (m->time - history->time < window) {
+			if (history->dir != m->dir && history->reversals < 255)
+				history->reversals++;
+		} else
+			history->reversals >>= 1;
+		history->bytes = (3 * history->bytes + m->bytes) / 4;
+	} else
+		history->bytes = m->bytes;
+
+	history->time = m->time;
+	history->dir = m->dir;
+	history->valid = true;
+}
+
+void sna_migrate_trace_write(FILE *file, const struct sna_migration *m)
+{
+	fprintf(file, "%u %u %s %s %u %d %d %s\n",
+		m->time, m->pixmap,
+		sna_migrate_op_name(m->op), dir_names[m->dir & 1],
+		m->bytes, m->optional, m->allowed,
+		m->reason ?: "-");
+}
+
+bool sna_migrate_trace_read(FILE *file, struct sna_migration *m,
+			    char *reason, int len)
+{
+	char line[512], op[32], dir[8];
+	int optional, allowed, n;
+
+	while (fgets(line, sizeof(line), file)) {
+		if (sscanf(line, "%u %u %31s %7s %u %d %d %n",
+			   &m->time, &m->pixmap, op, dir,
+			   &m->bytes, &optional, &allowed, &n) != 7)
+			continue;
+
+		for (m->op = 0; m->op < MIGRATE_NUM_OPS; m->op++)
+			if (strcmp(op, op_names[m->op]) == 0)
+				break;
+		if (m->op == MIGRATE_NUM_OPS)
+			continue;
+
+		m->dir = strcmp(dir, dir_names[MIGRATE_TO_GPU]) == 0;
+		m->optional = optional;
+		m->allowed = allowed;
+
+		if (reason && len > 0) {
+			strncpy(reason, line + n, len - 1);
+			reason[len - 1] = '\0';
+			reason[strcspn(reason, "\n")] = '\0';
+			m->reason = reason;
+		} else
+			m->reason = NULL;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef SNA_MIGRATE_H
+#define SNA_MIGRATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Pixmap migration bookkeeping. Every transfer of pixels between the
+ * CPU and GPU copies of a pixmap is described by a struct sna_migration,
+ * which can be written to a trace and later replayed against alternative
+ * policies (see test/migrate-replay.c). The policy is consulted only for
+ * optional migrations, where the caller has a viable alternative should
+ * the migration be refused; mandatory migrations are merely recorded.
+ *
+ * This file must not depend upon the X server so that the replay tool
+ * can be built standalone.
+ */
+
+enum sna_migrate_dir {
+	MIGRATE_TO_CPU = 0,
+	MIGRATE_TO_GPU,
+};
+
+enum sna_migrate_op {
+	MIGRATE_MOVE_TO_CPU = 0,
+	MIGRATE_MOVE_REGION_TO_CPU,
+	MIGRATE_MOVE_TO_GPU,
+	MIGRATE_MOVE_AREA_TO_GPU,
+	MIGRATE_USE_BO,
+	MIGRATE_NUM_OPS
+};
+
+struct sna_migration {
+	uint32_t time; /* ms */
+	uint32_t pixmap; /* drawable serial number */
+	uint32_t bytes;
+	uint8_t op;
+	uint8_t dir;
+	uint8_t optional;
+	uint8_t allowed;
+	const char *reason;
+};
+
+/* Per-pixmap record of recent migrations, embedded in struct sna_pixmap */
+struct sna_migrate_history {
+	uint32_t time; /* of the last migration */
+	uint32_t bytes; /* decaying average of bytes per migration */
+	uint8_t dir;
+	uint8_t reversals; /* direction changes within the window, saturating */
+	uint8_t valid;
+};
+
+struct sna_migrate_policy {
+	const char *name;
+	uint32_t window; /* ms */
+	bool (*allow)(const struct sna_migrate_policy *policy,
+		      const struct sna_migrate_history *history,
+		      const struct sna_migration *m);
+};
+
+extern const struct sna_migrate_policy sna_migrate_greedy;
+extern const struct sna_migrate_policy sna_migrate_hysteresis;
+
+const struct sna_migrate_policy *sna_migrate_policy_lookup(const char *name);
+const char *sna_migrate_op_name(unsigned op);
+
+bool sna_migrate_decide(const struct sna_migrate_policy *policy,
+			const struct sna_migrate_history *history,
+			struct sna_migration *m);
+void sna_migrate_update(const struct sna_migrate_policy *policy,
+			struct sna_migrate_history *history,
+			const struct sna_migration *m);
+
+void sna_migrate_trace_write(FILE *file, const struct sna_migration *m);
+bool sna_migrate_trace_read(FILE *file, struct sna_migration *m,
+			    char *reason, int len);
+
+#endif /* SNA_MIGRATE_H */
@@ -0,0 +1,107 @@
+#ifndef SNA_PROFILE_H
+#define SNA_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+/*
+ * A cheap profiler for the protocol entry points. Each operation is
+ * bracketed by sna_profile_begin()/sna_profile_end(), which accumulate
+ * the number of calls, an estimate of the pixels touched, how many
+ * calls fell back to the CPU and the time spent (inclusive of any
+ * nested operation) in CPU cycles where available.
+ *
+ * Enabled by Option "DebugProfile"; the counters are dumped to the log
+ * upon SIGUSR2, alongside "DebugStats" and on server shutdown.
+ */
+
+enum sna_profile_op {
+	PROFILE_FILL_SPANS = 0,
+	PROFILE_SET_SPANS,
+	PROFILE_PUT_IMAGE,
+	PROFILE_COPY_AREA,
+	PROFILE_COPY_PLANE,
+	PROFILE_POLY_POINT,
+	PROFILE_POLY_LINE,
+	PROFILE_POLY_SEGMENT,
+	PROFILE_POLY_RECTANGLE,
+	PROFILE_POLY_ARC,
+	PROFILE_FILL_POLYGON,
+	PROFILE_POLY_FILL_RECT,
+	PROFILE_POLY_FILL_ARC,
+	PROFILE_POLY_TEXT,
+	PROFILE_IMAGE_TEXT,
+	PROFILE_IMAGE_GLYPH,
+	PROFILE_POLY_GLYPH,
+	PROFILE_PUSH_PIXELS,
+	PROFILE_GET_IMAGE,
+	PROFILE_COPY_WINDOW,
+	PROFILE_COMPOSITE,
+	PROFILE_COMPOSITE_RECTS,
+	PROFILE_GLYPHS,
+	PROFILE_TRAPEZOIDS,
+	PROFILE_TRIANGLES,
+	PROFILE_NUM_OPS
+};
+
+struct sna_profile {
+	struct sna_profile_counter {
+		uint64_t calls;
+		uint64_t pixels;
+		uint64_t fallbacks;
+		uint64_t cycles;
+	} op[PROFILE_NUM_OPS];
+	uint32_t start_time; /* ms, of the current sample period */
+	unsigned dumped; /* last dump request serviced */
+	bool fallback; /* set if the current operation used the CPU */
+};
+
+struct sna_profile_sample {
+	uint64_t start;
+	bool fallback;
+};
+
+static inline uint64_t sna_profile_clock(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	uint32_t lo, hi;
+	__asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+	return (uint64_t)hi << 32 | lo;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static inline void sna_profile_begin(struct sna_profile *profile,
+				     struct sna_profile_sample *sample)
+{
+	/* Preserve the outer operation's state across nested calls */
+	sample->fallback = profile->fallback;
+	profile->fallback = false;
+	sample->start = sna_profile_clock();
+}
+
+static inline void sna_profile_end(struct sna_profile *profile,
+				   struct sna_profile_sample *sample,
+				   enum sna_profile_op op,
+				   uint64_t pixels)
+{
+	struct sna_profile_counter *c = &profile->op[op];
+
+	c->cycles += sna_profile_clock() - sample->start;
+	c->calls++;
+	c->pixels += pixels;
+	c->fallbacks += profile->fallback;
+
+	profile->fallback |= sample->fallback;
+}
+
+static inline void sna_profile_fallback(struct sna_profile *profile)
+{
+	profile->fallback = true;
+}
+
+#endif /* SNA_PROFILE_H */
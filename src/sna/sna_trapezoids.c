@@ -5502,17 +5502,20 @@ sna_composite_trapezoids(CARD8 op,
 
 	if (wedged(sna)) {
 		DBG(("%s: fallback -- wedged\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_WEDGED);
 		goto fallback;
 	}
 
 	if (dst->alphaMap) {
 		DBG(("%s: fallback -- dst alpha map\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_ALPHA_MAP);
 		goto fallback;
 	}
 
 	priv = sna_pixmap(pixmap);
 	if (priv == NULL) {
 		DBG(("%s: fallback -- dst is unattached\n", __FUNCTION__));
+		sna_fallback_reason(sna, FALLBACK_UNATTACHED);
 		goto fallback;
 	}
 
@@ -5585,8 +5588,10 @@ sna_composite_trapezoids(CARD8 op,
 		flags |= COMPOSITE_SPANS_RECTILINEAR;
 	}
 
-	if (force_fallback)
+	if (force_fallback) {
+		sna_fallback_reason(sna, FALLBACK_CPU);
 		goto fallback;
+	}
 
 	if (is_mono(dst, maskFormat) &&
 	    mono_trapezoids_span_converter(op, src, dst,
@@ -5615,7 +5620,15 @@ sna_composite_trapezoids(CARD8 op,
 				     xSrc, ySrc, ntrap, traps))
 		return;
 
+	sna_fallback_reason(sna, FALLBACK_SPANS);
 fallback:
+	{
+		BoxRec box;
+
+		trapezoids_bounds(ntrap, traps, &box);
+		sna_fallback_record(sna, &box);
+	}
+
 	if (trapezoid_span_inplace(op, src, dst, maskFormat,
 				   xSrc, ySrc, ntrap, traps,
 				   true))
@@ -6595,6 +6608,15 @@ sna_composite_triangles(CARD8 op,
 				     n, tri))
 		return;
 
+	{
+		struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+		BoxRec box;
+
+		miTriangleBounds(n, tri, &box);
+		sna_fallback_reason(sna, FALLBACK_SPANS);
+		sna_fallback_record(sna, &box);
+	}
+
 	triangles_fallback(op, src, dst, maskFormat, xSrc, ySrc, n, tri);
 }
 
@@ -6868,6 +6890,15 @@ sna_composite_tristrip(CARD8 op,
 	if (tristrip_span_converter(op, src, dst, maskFormat, xSrc, ySrc, n, points))
 		return;
 
+	{
+		struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+		BoxRec box;
+
+		miPointFixedBounds(n, points, &box);
+		sna_fallback_reason(sna, FALLBACK_SPANS);
+		sna_fallback_record(sna, &box);
+	}
+
 	tristrip_fallback(op, src, dst, maskFormat, xSrc, ySrc, n, points);
 }
 
@@ -6999,5 +7030,14 @@ sna_composite_trifan(CARD8 op,
 		     INT16 xSrc, INT16 ySrc,
 		     int n, xPointFixed *points)
 {
+	{
+		struct sna *sna = to_sna_from_drawable(dst->pDrawable);
+		BoxRec box;
+
+		miPointFixedBounds(n, points, &box);
+		sna_fallback_reason(sna, FALLBACK_SPANS);
+		sna_fallback_record(sna, &box);
+	}
+
 	trifan_fallback(op, src, dst, maskFormat, xSrc, ySrc, n, points);
 }
@@ -89,6 +89,14 @@ void sna_video_free_buffers(struct sna *sna, struct sna_video *video)
 		kgem_bo_destroy(&sna->kgem, video->buf);
 		video->buf = NULL;
 	}
+
+	for (i = 0; i < ARRAY_SIZE(video->frames); i++) {
+		if (video->frames[i]) {
+			kgem_bo_destroy(&sna->kgem, video->frames[i]);
+			video->frames[i] = NULL;
+		}
+	}
+	video->next_frame = 0;
 }
 
 struct kgem_bo *
@@ -107,6 +115,58 @@ sna_video_buffer(struct sna *sna,
 	return video->buf;
 }
 
+struct kgem_bo *
+sna_video_frame_buffer(struct sna *sna,
+		       struct sna_video *video,
+		       struct sna_video_frame *frame)
+{
+	struct kgem_bo *bo;
+	int i, n;
+
+	assert(video->num_frames <= SNA_VIDEO_MAX_FRAMES);
+	if (video->num_frames == 0)
+		return NULL;
+
+	/* Look for an idle buffer, oldest first, so that we can write
+	 * the next frame whilst the GPU is still sampling from the
+	 * previous ones.
+	 */
+	for (n = 0; n < video->num_frames; n++) {
+		i = (video->next_frame + n) % video->num_frames;
+
+		bo = video->frames[i];
+		if (bo && __kgem_bo_size(bo) < frame->size) {
+			kgem_bo_destroy(&sna->kgem, bo);
+			video->frames[i] = bo = NULL;
+		}
+
+		if (bo == NULL || !__kgem_bo_is_busy(&sna->kgem, bo))
+			goto out;
+	}
+
+	/* Every frame is still in flight (or queued in the current batch);
+	 * rather than overwrite one, let the caller upload into a fresh
+	 * buffer.
+	 */
+	DBG(("%s: all %d frames busy\n", __FUNCTION__, video->num_frames));
+	return NULL;
+
+out:
+	if (video->frames[i] == NULL) {
+		video->frames[i] = kgem_create_linear(&sna->kgem, frame->size,
+						      CREATE_GTT_MAP);
+		if (video->frames[i] == NULL)
+			return NULL;
+	}
+
+	DBG(("%s: using frame %d/%d, handle=%d, busy? %d\n",
+	     __FUNCTION__, i, video->num_frames, video->frames[i]->handle,
+	     kgem_bo_is_busy(video->frames[i])));
+
+	video->next_frame = (i + 1) % video->num_frames;
+	return kgem_bo_reference(video->frames[i]);
+}
+
 void sna_video_buffer_fini(struct sna *sna,
 			   struct sna_video *video)
 {
@@ -516,6 +576,72 @@ sna_video_copy_data(struct sna *sna,
 	return true;
 }
 
+bool
+sna_video_map_data(struct sna *sna,
+		   struct sna_video *video,
+		   struct sna_video_frame *frame,
+		   const uint8_t *buf)
+{
+	uint32_t len;
+
+	DBG(("%s: size=%dx%d, rotation=%d, buf=%p\n",
+	     __FUNCTION__, frame->width, frame->height, video->rotation, buf));
+
+	if (!sna->kgem.has_userptr)
+		return false;
+
+	/* We can only sample directly from the client's memory if it
+	 * already has the layout we would have copied it into.
+	 */
+	if (video->rotation != RR_Rotate_0)
+		return false;
+
+	if (frame->top || frame->left)
+		return false;
+
+	if ((uintptr_t)buf & (PAGE_SIZE - 1))
+		return false;
+
+	if (is_planar_fourcc(frame->id)) {
+		if (frame->pitch[0] != ALIGN((frame->width >> 1), 0x4) ||
+		    frame->pitch[1] != ALIGN(frame->width, 0x4))
+			return false;
+
+		len = (uint32_t)frame->pitch[1]*frame->height +
+			(uint32_t)frame->pitch[0]*frame->height;
+	} else {
+		if (frame->pitch[0] != frame->width*2)
+			return false;
+
+		len = (uint32_t)frame->pitch[0]*frame->height;
+	}
+
+	/* For small frames the copy is cheaper than pinning the pages
+	 * and then waiting for the GPU to finish sampling from them.
+	 */
+	if (len < 256*1024)
+		return false;
+
+	frame->bo = kgem_create_map(&sna->kgem, (void *)buf,
+				    ALIGN(len, PAGE_SIZE), true);
+	if (frame->bo == NULL)
+		return false;
+
+	frame->bo->flush = true;
+	frame->bo->reusable = false;
+
+	if (is_planar_fourcc(frame->id) && frame->id != FOURCC_I420) {
+		uint32_t tmp;
+		tmp = frame->VBufOffset;
+		frame->VBufOffset = frame->UBufOffset;
+		frame->UBufOffset = tmp;
+	}
+
+	DBG(("%s: mapped client frame, handle=%d, len=%d\n",
+	     __FUNCTION__, frame->bo->handle, len));
+	return true;
+}
+
 void sna_video_init(struct sna *sna, ScreenPtr screen)
 {
 	XF86VideoAdaptorPtr *adaptors, *newAdaptors;
@@ -35,6 +35,8 @@ THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SNA_XVMC 1
 #endif
 
+#define SNA_VIDEO_MAX_FRAMES 8
+
 struct sna_video {
 	int brightness;
 	int contrast;
@@ -57,6 +59,11 @@ struct sna_video {
 	struct kgem_bo *old_buf[2];
 	struct kgem_bo *buf;
 
+	/** Frames queued for sampling by the GPU (textured video) */
+	struct kgem_bo *frames[SNA_VIDEO_MAX_FRAMES];
+	int num_frames;
+	int next_frame;
+
 	bool textured;
 	Rotation rotation;
 	int plane;
@@ -129,6 +136,17 @@ sna_video_copy_data(struct sna *sna,
 		    struct sna_video_frame *frame,
 		    const uint8_t *buf);
 
+bool
+sna_video_map_data(struct sna *sna,
+		   struct sna_video *video,
+		   struct sna_video_frame *frame,
+		   const uint8_t *buf);
+
+struct kgem_bo *
+sna_video_frame_buffer(struct sna *sna,
+		       struct sna_video *video,
+		       struct sna_video_frame *frame);
+
 void sna_video_buffer_fini(struct sna *sna,
 			   struct sna_video *video);
 
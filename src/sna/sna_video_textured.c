@@ -31,6 +31,8 @@
 #include "sna.h"
 #include "sna_video.h"
 
+#include "intel_options.h"
+
 #include <xf86xv.h>
 #include <X11/extensions/Xv.h>
 
@@ -222,6 +224,7 @@ sna_video_textured_put_image(ScrnInfoPtr scrn,
 	BoxRec dstBox;
 	xf86CrtcPtr crtc;
 	bool flush = false;
+	bool mapped = false;
 	bool ret;
 
 	DBG(("%s: src=(%d, %d),(%d, %d), dst=(%d, %d),(%d, %d), id=%d, sizep=%dx%d, sync?=%d\n",
@@ -267,10 +270,16 @@ sna_video_textured_put_image(ScrnInfoPtr scrn,
 		}
 
 		assert(kgem_bo_size(frame.bo) >= frame.size);
+	} else if (sna_video_map_data(sna, video, &frame, buf)) {
+		DBG(("%s: sampling directly from client memory\n",
+		     __FUNCTION__));
+		mapped = true;
 	} else {
+		frame.bo = sna_video_frame_buffer(sna, video, &frame);
 		if (!sna_video_copy_data(sna, video, &frame, buf)) {
 			DBG(("%s: failed to copy frame\n", __FUNCTION__));
-			kgem_bo_destroy(&sna->kgem, frame.bo);
+			if (frame.bo)
+				kgem_bo_destroy(&sna->kgem, frame.bo);
 			return BadAlloc;
 		}
 	}
@@ -291,6 +300,10 @@ sna_video_textured_put_image(ScrnInfoPtr scrn,
 	} else
 		DamageDamageRegion(drawable, clip);
 
+	/* The client is free to reuse its buffer as soon as we return */
+	if (mapped)
+		kgem_bo_sync__cpu(&sna->kgem, frame.bo);
+
 	kgem_bo_destroy(&sna->kgem, frame.bo);
 
 	/* Push the frame to the GPU as soon as possible so
@@ -374,6 +387,7 @@ XF86VideoAdaptorPtr sna_video_textured_setup(struct sna *sna,
 	struct sna_video *video;
 	DevUnion *devUnions;
 	int nports = 16, i;
+	int num_frames = 3;
 
 	if (!sna->render.video) {
 		xf86DrvMsg(sna->scrn->scrnIndex, X_WARNING,
@@ -412,6 +426,18 @@ XF86VideoAdaptorPtr sna_video_textured_setup(struct sna *sna,
 	attrs = NULL;
 #endif
 
+	/* The number of frame buffers each port keeps in flight, so that
+	 * we can copy the next frame whilst the GPU samples the last.
+	 * A depth of 0 streams each frame through a fresh upload buffer.
+	 */
+	xf86GetOptValInteger(sna->Options, OPTION_XV_FRAMES, &num_frames);
+	if (num_frames < 0)
+		num_frames = 0;
+	if (num_frames > SNA_VIDEO_MAX_FRAMES)
+		num_frames = SNA_VIDEO_MAX_FRAMES;
+	xf86DrvMsg(sna->scrn->scrnIndex, X_INFO,
+		   "Textured video using a queue of %d frames\n", num_frames);
+
 	adaptor->type = XvWindowMask | XvInputMask | XvImageMask;
 	adaptor->flags = 0;
 	adaptor->name = "Intel(R) Textured Video";
@@ -450,6 +476,7 @@ XF86VideoAdaptorPtr sna_video_textured_setup(struct sna *sna,
 		v->textured = true;
 		v->rotation = RR_Rotate_0;
 		v->SyncToVblank = 1;
+		v->num_frames = num_frames;
 
 		/* gotta uninit this someplace, XXX: shouldn't be necessary for textured */
 		RegionNull(&v->clip);
@@ -98,6 +98,7 @@ void intelFlushBatch(Bool refill)
 			  0, 0, 0);
 
 	drm_intel_bo_unreference(xvmc_driver->batch.buf);
+	xvmc_driver->batch.serial++;
 	if ((xvmc_driver->batch.buf =
 	     drm_intel_bo_alloc(xvmc_driver->bufmgr,
 				"batch buffer", BATCH_SIZE, 0x1000)) == NULL) {
@@ -118,6 +118,20 @@ void UNLOCK_HARDWARE(drm_context_t ctx)
 	PPTHREAD_MUTEX_UNLOCK();
 }
 
+/* The decoder may leave commands queued in the batch (e.g. the slices
+ * of the current VLD frame); submit them if they render to the surface.
+ */
+static void intel_xvmc_flush_surface(intel_xvmc_surface_ptr intel_surf)
+{
+	intel_xvmc_context_ptr intel_ctx = intel_surf->context->privData;
+
+	LOCK_HARDWARE(intel_ctx->hw_context);
+	if (xvmc_driver->batch.ptr != xvmc_driver->batch.init_ptr &&
+	    drm_intel_bo_references(xvmc_driver->batch.buf, intel_surf->bo))
+		intelFlushBatch(TRUE);
+	UNLOCK_HARDWARE(intel_ctx->hw_context);
+}
+
 static int
 dri2_connect(Display *display)
 {
@@ -653,6 +667,8 @@ _X_EXPORT Status XvMCPutSurface(Display * display, XvMCSurface * surface,
 	}
 	intel_surf->last_draw = draw;
 
+	intel_xvmc_flush_surface(intel_surf);
+
 	drm_intel_bo_flink(intel_surf->bo, &intel_surf->gem_handle);
 
 	ret = XvPutImage(display, context->port, draw, intel_surf->gc,
@@ -669,9 +685,18 @@ _X_EXPORT Status XvMCPutSurface(Display * display, XvMCSurface * surface,
  */
 _X_EXPORT Status XvMCSyncSurface(Display * display, XvMCSurface * surface)
 {
+	intel_xvmc_surface_ptr intel_surf;
+
 	if (!display || !surface)
 		return XvMCBadSurface;
 
+	intel_surf = surface->privData;
+	if (!intel_surf || !intel_surf->context)
+		return XvMCBadSurface;
+
+	intel_xvmc_flush_surface(intel_surf);
+	drm_intel_bo_wait_rendering(intel_surf->bo);
+
 	return Success;
 }
 
@@ -687,9 +712,17 @@ _X_EXPORT Status XvMCSyncSurface(Display * display, XvMCSurface * surface)
  */
 _X_EXPORT Status XvMCFlushSurface(Display * display, XvMCSurface * surface)
 {
+	intel_xvmc_surface_ptr intel_surf;
+
 	if (!display || !surface)
 		return XvMCBadSurface;
 
+	intel_surf = surface->privData;
+	if (!intel_surf || !intel_surf->context)
+		return XvMCBadSurface;
+
+	intel_xvmc_flush_surface(intel_surf);
+
 	return Success;
 }
 
@@ -708,10 +741,18 @@ _X_EXPORT Status XvMCFlushSurface(Display * display, XvMCSurface * surface)
 _X_EXPORT Status XvMCGetSurfaceStatus(Display * display, XvMCSurface * surface,
 				      int *stat)
 {
+	intel_xvmc_surface_ptr intel_surf;
+
 	if (!display || !surface || !stat)
 		return XvMCBadSurface;
 
-	*stat = 0;
+	intel_surf = surface->privData;
+	if (!intel_surf || !intel_surf->context)
+		return XvMCBadSurface;
+
+	/* Query without blocking, but make sure the answer will change */
+	intel_xvmc_flush_surface(intel_surf);
+	*stat = drm_intel_bo_busy(intel_surf->bo) ? XVMC_RENDERING : 0;
 
 	return Success;
 }
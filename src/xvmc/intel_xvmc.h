@@ -135,6 +135,7 @@ typedef struct _intel_xvmc_driver {
 		unsigned char *ptr;
 		unsigned char *init_ptr;
 		dri_bo *buf;
+		unsigned int serial;	/* bumped on every flush */
 	} batch;
 
 	struct {
@@ -29,13 +29,16 @@
 #include "i965_reg.h"
 #include "brw_defines.h"
 #include "brw_structs.h"
+#include <time.h>
 
 #ifndef ALIGN
 #define ALIGN(m,n) (((m) + (n) - 1) & ~((n) - 1))
 #endif
 
 #define BATCH_STRUCT(x) intelBatchbufferData(&x, sizeof(x), 0)
-#define VLD_MAX_SLICE_SIZE (32 * 1024)
+#define VLD_SLICE_BUFFER_SIZE (512 * 1024)
+/* state setup + media object + padding, in bytes */
+#define VLD_SLICE_BATCH_SPACE (40 * 4)
 #define CS_SIZE 	30
 #define URB_SIZE 	384
 /* idct table */
@@ -332,8 +335,17 @@ struct binding_table_obj {
 	struct surface_state_obj surface_states[MAX_SURFACES];
 };
 
+/* Slices are packed one after another into a pair of buffers, so that
+ * the next frame (or the rest of this one, once a batch reading from the
+ * current buffer has been submitted) can be uploaded while the GPU
+ * decodes the last.
+ */
 struct slice_data_obj {
-	dri_bo *bo;
+	dri_bo *bo[2];
+	int current;
+	uint32_t used;
+	/* batch.serial of the last batch to read from the current buffer */
+	unsigned int batch;
 };
 
 struct mb_data_obj {
@@ -351,8 +363,40 @@ static struct media_state {
 	struct cs_state_obj cs_object;
 	struct slice_data_obj slice_data;
 	struct mb_data_obj mb_data;
+	/* batch.serial + 1 of the batch holding the VLD pipeline setup */
+	unsigned int vld_batch;
 } media_state;
 
+/* Per-frame statistics, reported when INTEL_XVMC_STATS is set */
+static struct vld_stats {
+	Bool enabled;
+	unsigned int frame;
+	unsigned int slices;
+	unsigned int batches;
+	double cpu;
+} vld_stats;
+
+static double vld_cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void vld_stats_frame(void)
+{
+	if (vld_stats.enabled && vld_stats.slices)
+		XVMC_INFO("frame %u: %u slices in %u batches, %.3f ms cpu",
+			  vld_stats.frame, vld_stats.slices,
+			  vld_stats.batches, vld_stats.cpu * 1000);
+
+	vld_stats.frame++;
+	vld_stats.slices = 0;
+	vld_stats.batches = 0;
+	vld_stats.cpu = 0;
+}
+
 /* XvMCQMatrix * 2 + idct_table + 8 * kernel offset pointer */
 #define CS_OBJECT_SIZE (32*20 + sizeof(unsigned int) * 8)
 static void free_object(struct media_state *s)
@@ -368,7 +412,8 @@ static void free_object(struct media_state *s)
 	FREE_ONE_BO(s->binding_table.bo);
 	for (i = 0; i < MAX_SURFACES; i++)
 		FREE_ONE_BO(s->binding_table.surface_states[i].bo);
-	FREE_ONE_BO(s->slice_data.bo);
+	for (i = 0; i < 2; i++)
+		FREE_ONE_BO(s->slice_data.bo[i]);
 	FREE_ONE_BO(s->mb_data.bo);
 	FREE_ONE_BO(s->cs_object.bo);
 	FREE_ONE_BO(s->vld_state.bo);
@@ -392,6 +437,39 @@ out:
 	return BadAlloc;
 }
 
+/* Switch to the other slice buffer, replacing it rather than waiting
+ * should the GPU (or the pending batch) still be reading from it.
+ */
+static Bool slice_data_next(void)
+{
+	struct slice_data_obj *sd = &media_state.slice_data;
+	dri_bo *bo;
+
+	sd->current ^= 1;
+	sd->used = 0;
+
+	bo = sd->bo[sd->current];
+	if (bo && (drm_intel_bo_busy(bo) ||
+		   drm_intel_bo_references(xvmc_driver->batch.buf, bo))) {
+		drm_intel_bo_unreference(bo);
+		bo = NULL;
+	}
+	if (bo == NULL) {
+		bo = drm_intel_bo_alloc(xvmc_driver->bufmgr, "slice data",
+					VLD_SLICE_BUFFER_SIZE, 64);
+		sd->bo[sd->current] = bo;
+	}
+
+	return bo != NULL;
+}
+
+/* Submit whatever has been queued so far, e.g. the previous frame */
+static void vld_flush_batch(void)
+{
+	if (xvmc_driver->batch.ptr != xvmc_driver->batch.init_ptr)
+		intelFlushBatch(TRUE);
+}
+
 static void flush()
 {
 #define FLUSH_STATE_CACHE  	1
@@ -610,6 +688,8 @@ static Status create_context(Display * display, XvMCContext * context,
 	intel_ctx->surface_bo_size
 		= SIZE_YUV420(context->width, context->height);
 
+	vld_stats.enabled = getenv("INTEL_XVMC_STATS") != NULL;
+
 	if (alloc_object(&media_state))
 		return BadAlloc;
 
@@ -787,12 +867,27 @@ static Status begin_surface(Display * display, XvMCContext * context,
 {
 	struct intel_xvmc_surface *priv_target, *priv_past, *priv_future;
 	intel_xvmc_context_ptr intel_ctx = context->privData;
+	double start = vld_stats.enabled ? vld_cpu_time() : 0;
 	Status ret;
 
 	priv_target = target->privData;
 	priv_past = past ? past->privData : NULL;
 	priv_future = future ? future->privData : NULL;
 
+	/* The slices of the previous frame are only queued by put_slice2(),
+	 * kick them off now before starting on the next.
+	 */
+	LOCK_HARDWARE(intel_ctx->hw_context);
+	vld_flush_batch();
+	UNLOCK_HARDWARE(intel_ctx->hw_context);
+	vld_stats_frame();
+
+	/* The state below is reallocated, so point the pipeline at it again */
+	media_state.vld_batch = 0;
+
+	if (!slice_data_next())
+		return BadAlloc;
+
 	ret = vld_state(control);
 	if (ret != Success)
 		return ret;
@@ -813,6 +908,9 @@ static Status begin_surface(Display * display, XvMCContext * context,
 	LOCK_HARDWARE(intel_ctx->hw_context);
 	flush();
 	UNLOCK_HARDWARE(intel_ctx->hw_context);
+
+	if (vld_stats.enabled)
+		vld_stats.cpu += vld_cpu_time() - start;
 	return Success;
 }
 
@@ -957,7 +1055,7 @@ static void send_media_object(XvMCMacroBlock * mb, dri_bo * bo,
 }
 
 /* kick media object to gpu in vld mode*/
-static void vld_send_media_object(dri_bo * bo,
+static void vld_send_media_object(dri_bo * bo, uint32_t offset,
 				  int slice_len, int mb_h_pos, int mb_v_pos,
 				  int mb_bit_offset, int mb_count,
 				  int q_scale_code)
@@ -967,7 +1065,7 @@ static void vld_send_media_object(dri_bo * bo,
 	OUT_BATCH(BRW_MEDIA_OBJECT | 4);
 	OUT_BATCH(0);
 	OUT_BATCH(slice_len);
-	OUT_RELOC(bo, I915_GEM_DOMAIN_INSTRUCTION, 0, 0);
+	OUT_RELOC(bo, I915_GEM_DOMAIN_INSTRUCTION, 0, offset);
 	OUT_BATCH((mb_h_pos << 24) | (mb_v_pos << 16) | (mb_count << 8) |
 		  (mb_bit_offset));
 	OUT_BATCH(q_scale_code << 24);
@@ -980,7 +1078,13 @@ static Status put_slice2(Display * display, XvMCContext * context,
 	unsigned int bit_buf;
 	intel_xvmc_context_ptr intel_ctx = context->privData;
 	struct intel_xvmc_hw_context *hw_ctx = intel_ctx->hw;
+	struct slice_data_obj *sd = &media_state.slice_data;
+	double start = vld_stats.enabled ? vld_cpu_time() : 0;
 	int q_scale_code, mb_row;
+	uint32_t offset;
+
+	if (nbytes > VLD_SLICE_BUFFER_SIZE)
+		return BadValue;
 
 	mb_row = *(slice - 1) - 1;
 	bit_buf =
@@ -988,32 +1092,50 @@ static Status put_slice2(Display * display, XvMCContext * context,
 
 	q_scale_code = bit_buf >> 27;
 
-	if (media_state.slice_data.bo) {
-		drm_intel_gem_bo_unmap_gtt(media_state.slice_data.bo);
+	LOCK_HARDWARE(intel_ctx->hw_context);
 
-		drm_intel_bo_unreference(media_state.slice_data.bo);
+	if (xvmc_driver->batch.space < VLD_SLICE_BATCH_SPACE)
+		intelFlushBatch(TRUE);
+
+	/* Writing into a buffer that a submitted batch is still reading
+	 * from would stall, so move on to the other one instead.
+	 */
+	if (sd->bo[sd->current] == NULL ||
+	    sd->used + nbytes > VLD_SLICE_BUFFER_SIZE ||
+	    (sd->used && sd->batch != xvmc_driver->batch.serial)) {
+		if (!slice_data_next()) {
+			UNLOCK_HARDWARE(intel_ctx->hw_context);
+			return BadAlloc;
+		}
 	}
-	media_state.slice_data.bo = drm_intel_bo_alloc(xvmc_driver->bufmgr,
-						       "slice data",
-						       VLD_MAX_SLICE_SIZE, 64);
-	if (!media_state.slice_data.bo)
-		return BadAlloc;
-	drm_intel_gem_bo_map_gtt(media_state.slice_data.bo);
 
-	memcpy(media_state.slice_data.bo->virtual, slice, nbytes);
-
-	LOCK_HARDWARE(intel_ctx->hw_context);
-	state_base_address(hw_ctx);
-	pipeline_select();
-	media_state_pointers(VFE_VLD_MODE);
-	urb_layout();
-	cs_urb_layout();
-	cs_buffer();
-	vld_send_media_object(media_state.slice_data.bo,
+	offset = sd->used;
+	drm_intel_bo_subdata(sd->bo[sd->current], offset, nbytes, slice);
+	sd->used = ALIGN(offset + nbytes, 64);
+	sd->batch = xvmc_driver->batch.serial;
+
+	/* Queue the slice behind the others of this frame, only setting up
+	 * the media pipeline at the start of each batch.
+	 */
+	if (media_state.vld_batch != xvmc_driver->batch.serial + 1) {
+		state_base_address(hw_ctx);
+		pipeline_select();
+		media_state_pointers(VFE_VLD_MODE);
+		urb_layout();
+		cs_urb_layout();
+		cs_buffer();
+		media_state.vld_batch = xvmc_driver->batch.serial + 1;
+		vld_stats.batches++;
+	}
+	vld_send_media_object(sd->bo[sd->current], offset,
 			      nbytes, 0, mb_row, 6, 127, q_scale_code);
-	intelFlushBatch(TRUE);
 	UNLOCK_HARDWARE(intel_ctx->hw_context);
 
+	if (vld_stats.enabled) {
+		vld_stats.slices++;
+		vld_stats.cpu += vld_cpu_time() - start;
+	}
+
 	return Success;
 }
 
@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Filled and outlined arcs, as used for the markers in charts and
+ * schematics. First check that we match the reference server for
+ * complete ellipses and for slices of every size, then time how quickly
+ * we draw a screenful of small circles.
+ */
+
+#define FULL_CIRCLE (360 * 64)
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static GC create_gc(struct test_display *dpy, struct test_target *tt,
+		    int alu, int width, int mode)
+{
+	XGCValues val;
+
+	val.function = alu;
+	val.foreground = WhitePixel(dpy->dpy, 0);
+	val.line_width = width;
+	val.arc_mode = mode;
+
+	return XCreateGC(dpy->dpy, tt->draw,
+			 GCForeground |
+			 GCFunction |
+			 GCLineWidth |
+			 GCArcMode,
+			 &val);
+}
+
+static int random_arcs(XArc *arc, int n, int size, int max, int full)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		arc[i].width = rand() % max;
+		arc[i].height = rand() & 1 ? arc[i].width : rand() % max;
+		arc[i].x = rand() % size - arc[i].width / 2;
+		arc[i].y = rand() % size - arc[i].height / 2;
+		if (full) {
+			arc[i].angle1 = 0;
+			arc[i].angle2 = FULL_CIRCLE;
+		} else {
+			arc[i].angle1 = rand() % FULL_CIRCLE;
+			arc[i].angle2 = rand() % (2*FULL_CIRCLE) - FULL_CIRCLE;
+		}
+	}
+
+	return n;
+}
+
+static void arc_tests(struct test *t, int reps, int sets, enum target target)
+{
+	struct test_target real, ref;
+	XArc arc[64];
+	char buf[1024];
+	int fill, full, r, s;
+
+	printf("Testing arcs (%s): ", test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (fill = 0; fill <= 1; fill++) {
+		for (full = 0; full <= 1; full++) {
+			for (s = 0; s < sets; s++) {
+				clear(&t->real, &real);
+				clear(&t->ref, &ref);
+
+				for (r = 0; r < reps; r++) {
+					int alu = rand() % (GXset + 1);
+					int lw = fill ? 0 : rand() % 4;
+					int mode = rand() & 1 ? ArcPieSlice : ArcChord;
+					int n = random_arcs(arc, 1 + rand() % 64,
+							    real.width,
+							    rand() & 1 ? 32 : 1000,
+							    full);
+					GC gc;
+
+					gc = create_gc(&t->real, &real, alu, lw, mode);
+					if (fill)
+						XFillArcs(t->real.dpy, real.draw, gc, arc, n);
+					else
+						XDrawArcs(t->real.dpy, real.draw, gc, arc, n);
+					XFreeGC(t->real.dpy, gc);
+
+					gc = create_gc(&t->ref, &ref, alu, lw, mode);
+					if (fill)
+						XFillArcs(t->ref.dpy, ref.draw, gc, arc, n);
+					else
+						XDrawArcs(t->ref.dpy, ref.draw, gc, arc, n);
+					XFreeGC(t->ref.dpy, gc);
+				}
+
+				sprintf(buf, "fill=%d, full=%d, set=%d",
+					fill, full, s);
+				test_compare(t,
+					     real.draw, real.format,
+					     ref.draw, ref.format,
+					     0, 0, real.width, real.height,
+					     buf);
+			}
+		}
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations x %d]\n", reps, sets);
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	struct test_target real;
+	XArc arc[1024];
+	int fill, size;
+
+	printf("Timing circles (%s):\n", test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+
+	for (fill = 0; fill <= 1; fill++) {
+		printf("  %-8s", fill ? "filled" : "outline");
+		for (size = 2; size <= 64; size <<= 1) {
+			struct timespec start, end;
+			GC gc;
+			int i;
+
+			for (i = 0; i < (int)ARRAY_SIZE(arc); i++) {
+				arc[i].x = rand() % (real.width - size);
+				arc[i].y = rand() % (real.height - size);
+				arc[i].width = arc[i].height = size;
+				arc[i].angle1 = 0;
+				arc[i].angle2 = FULL_CIRCLE;
+			}
+
+			gc = create_gc(&t->real, &real, GXcopy, 0, ArcPieSlice);
+
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (i = 0; i < 10; i++) {
+				if (fill)
+					XFillArcs(t->real.dpy, real.draw, gc,
+						  arc, ARRAY_SIZE(arc));
+				else
+					XDrawArcs(t->real.dpy, real.draw, gc,
+						  arc, ARRAY_SIZE(arc));
+			}
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			XFreeGC(t->real.dpy, gc);
+
+			printf(" %2d:%8.0f", size,
+			       10 * ARRAY_SIZE(arc) / elapsed(&start, &end));
+		}
+		printf(" arcs/s\n");
+	}
+
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		arc_tests(&test, 16, 8, t);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Reading back rectangles of every size, as done by screenshot tools
+ * and clients that composite in software. First check that random
+ * sub-rectangles match the reference server, then time the readback
+ * bandwidth for a range of sizes.
+ */
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static void fill_random(struct test_display *dpy, struct test_target *tt,
+			unsigned seed)
+{
+	XGCValues val;
+	GC gc;
+	int i;
+
+	val.function = GXcopy;
+	gc = XCreateGC(dpy->dpy, tt->draw, GCFunction, &val);
+
+	srand(seed);
+	for (i = 0; i < 256; i++) {
+		XSetForeground(dpy->dpy, gc, rand());
+		XFillRectangle(dpy->dpy, tt->draw, gc,
+			       rand() % tt->width, rand() % tt->height,
+			       rand() % 64 + 1, rand() % 64 + 1);
+	}
+	XFreeGC(dpy->dpy, gc);
+}
+
+static void compare_images(XImage *real, XImage *ref,
+			   int x, int y, int w, int h, int depth)
+{
+	int i, j;
+
+	for (j = 0; j < h; j++) {
+		for (i = 0; i < w; i++) {
+			uint32_t a = XGetPixel(real, i, j);
+			uint32_t b = XGetPixel(ref, i, j);
+
+			if (!pixel_equal(depth, a, b))
+				die("discrepancy at (%d, %d) reading %dx%d+%d+%d: found %08x, expected %08x\n",
+				    x + i, y + j, w, h, x, y, a, b);
+		}
+	}
+}
+
+static void readback_tests(struct test *t, int reps, int sets, enum target target)
+{
+	struct test_target real, ref;
+	int r, s;
+
+	printf("Testing readback (%s): ", test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (s = 0; s < sets; s++) {
+		unsigned seed = rand();
+
+		clear(&t->real, &real);
+		clear(&t->ref, &ref);
+
+		fill_random(&t->real, &real, seed);
+		fill_random(&t->ref, &ref, seed);
+
+		for (r = 0; r < reps; r++) {
+			int w = 1 + rand() % (r & 1 ? 64 : real.width);
+			int h = 1 + rand() % (r & 2 ? 64 : real.height);
+			int x = rand() % (real.width - w + 1);
+			int y = rand() % (real.height - h + 1);
+			XImage *real_image, *ref_image;
+
+			real_image = XGetImage(t->real.dpy, real.draw,
+					       x, y, w, h, AllPlanes, ZPixmap);
+			ref_image = XGetImage(t->ref.dpy, ref.draw,
+					      x, y, w, h, AllPlanes, ZPixmap);
+			die_unless(real_image && ref_image);
+
+			compare_images(real_image, ref_image,
+				       x, y, w, h, real.format->depth);
+
+			XDestroyImage(real_image);
+			XDestroyImage(ref_image);
+		}
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations x %d]\n", reps, sets);
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	struct test_target real;
+	GC gc;
+	int size;
+
+	printf("Timing readback (%s):\n", test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+	fill_random(&t->real, &real, 0);
+	gc = XCreateGC(t->real.dpy, real.draw, 0, NULL);
+
+	printf(" ");
+	for (size = 16; size <= 1024; size <<= 1) {
+		struct timespec start, end;
+		XImage *image;
+		int w = size < real.width ? size : real.width;
+		int h = size < real.height ? size : real.height;
+		int i, n = 64;
+
+		/* Make the target busy again before each read */
+		XFillRectangle(t->real.dpy, real.draw, gc, 0, 0, 1, 1);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < n; i++) {
+			image = XGetImage(t->real.dpy, real.draw,
+					  0, 0, w, h, AllPlanes, ZPixmap);
+			die_unless(image);
+			XDestroyImage(image);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		printf(" %4dx%-4d:%7.1f", w, h,
+		       n * w * h * 4 / elapsed(&start, &end) / (1024*1024));
+	}
+	printf(" MB/s\n");
+
+	XFreeGC(t->real.dpy, gc);
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		readback_tests(&test, 32, 8, t);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
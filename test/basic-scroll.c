@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Scrolling, as performed by terminals and text views: long runs of
+ * small CopyArea requests within the same drawable, each followed by
+ * an exposure fill of the uncovered strip, and interleaved copies
+ * from a backing pixmap. First check that we match the reference
+ * server, then time how many scroll requests we can process.
+ */
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static GC create_gc(struct test_display *dpy, Drawable d, int alu)
+{
+	XGCValues val;
+
+	val.function = alu;
+	val.graphics_exposures = 0;
+
+	return XCreateGC(dpy->dpy, d,
+			 GCFunction | GCGraphicsExposures,
+			 &val);
+}
+
+static void fill_random(struct test_display *dpy, Drawable d,
+			int width, int height, unsigned seed)
+{
+	GC gc = create_gc(dpy, d, GXcopy);
+	int i;
+
+	srand(seed);
+	for (i = 0; i < 64; i++) {
+		XSetForeground(dpy->dpy, gc, rand());
+		XFillRectangle(dpy->dpy, d, gc,
+			       rand() % width, rand() % height,
+			       rand() % 64 + 1, rand() % 64 + 1);
+	}
+	XFreeGC(dpy->dpy, gc);
+}
+
+struct scroll {
+	int x, y, w, h, dy;
+	int alu;
+	int src;
+};
+
+static void random_scroll(struct scroll *s, int width, int height)
+{
+	s->w = 1 + rand() % (width / 2);
+	s->h = 2 + rand() % (height / 4);
+	s->x = rand() % (width - s->w);
+	s->y = rand() % (height - s->h);
+	s->dy = 1 + rand() % (s->h - 1);
+	if (rand() & 1)
+		s->dy = -s->dy;
+	s->alu = rand() & 7 ? GXcopy : rand() % (GXset + 1);
+	s->src = (rand() & 3) == 0;
+}
+
+static void scroll(struct test_display *dpy, struct test_target *tt,
+		   Pixmap backing, GC gc, GC fill, const struct scroll *s)
+{
+	XSetFunction(dpy->dpy, gc, s->alu);
+	if (s->src) {
+		XCopyArea(dpy->dpy, backing, tt->draw, gc,
+			  s->x, s->y, s->w, s->h, s->x, s->y);
+	} else if (s->dy > 0) {
+		XCopyArea(dpy->dpy, tt->draw, tt->draw, gc,
+			  s->x, s->y + s->dy, s->w, s->h - s->dy, s->x, s->y);
+		XFillRectangle(dpy->dpy, tt->draw, fill,
+			       s->x, s->y + s->h - s->dy, s->w, s->dy);
+	} else {
+		XCopyArea(dpy->dpy, tt->draw, tt->draw, gc,
+			  s->x, s->y, s->w, s->h + s->dy, s->x, s->y - s->dy);
+		XFillRectangle(dpy->dpy, tt->draw, fill,
+			       s->x, s->y, s->w, -s->dy);
+	}
+}
+
+static void scroll_tests(struct test *t, int reps, int sets, enum target target)
+{
+	struct test_target real, ref;
+	Pixmap real_backing, ref_backing;
+	GC real_gc, ref_gc, real_fill, ref_fill;
+	char buf[1024];
+	int r, s;
+
+	printf("Testing scrolling (%s): ", test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	real_backing = XCreatePixmap(t->real.dpy, real.draw,
+				     real.width, real.height,
+				     real.format->depth);
+	ref_backing = XCreatePixmap(t->ref.dpy, ref.draw,
+				    ref.width, ref.height,
+				    ref.format->depth);
+
+	real_gc = create_gc(&t->real, real.draw, GXcopy);
+	ref_gc = create_gc(&t->ref, ref.draw, GXcopy);
+	real_fill = create_gc(&t->real, real.draw, GXcopy);
+	ref_fill = create_gc(&t->ref, ref.draw, GXcopy);
+
+	for (s = 0; s < sets; s++) {
+		unsigned seed = rand();
+
+		clear(&t->real, &real);
+		clear(&t->ref, &ref);
+
+		fill_random(&t->real, real_backing, real.width, real.height, seed);
+		fill_random(&t->ref, ref_backing, ref.width, ref.height, seed);
+		fill_random(&t->real, real.draw, real.width, real.height, ~seed);
+		fill_random(&t->ref, ref.draw, ref.width, ref.height, ~seed);
+
+		for (r = 0; r < reps; r++) {
+			struct scroll sc;
+			uint32_t fg = rand();
+
+			random_scroll(&sc, real.width, real.height);
+
+			XSetForeground(t->real.dpy, real_fill, fg);
+			scroll(&t->real, &real, real_backing, real_gc, real_fill, &sc);
+
+			XSetForeground(t->ref.dpy, ref_fill, fg);
+			scroll(&t->ref, &ref, ref_backing, ref_gc, ref_fill, &sc);
+		}
+
+		sprintf(buf, "set=%d", s);
+		test_compare(t,
+			     real.draw, real.format,
+			     ref.draw, ref.format,
+			     0, 0, real.width, real.height,
+			     buf);
+	}
+
+	XFreeGC(t->real.dpy, real_gc);
+	XFreeGC(t->ref.dpy, ref_gc);
+	XFreeGC(t->real.dpy, real_fill);
+	XFreeGC(t->ref.dpy, ref_fill);
+
+	XFreePixmap(t->real.dpy, real_backing);
+	XFreePixmap(t->ref.dpy, ref_backing);
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations x %d]\n", reps, sets);
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	struct test_target real;
+	GC gc;
+	int size;
+
+	printf("Timing small scrolls (%s):\n", test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+	gc = create_gc(&t->real, real.draw, GXcopy);
+
+	printf(" ");
+	for (size = 16; size <= 256; size <<= 1) {
+		struct timespec start, end;
+		int i, n = 10000;
+
+		xsync(t->real.dpy, real.draw);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < n; i++)
+			XCopyArea(t->real.dpy, real.draw, real.draw, gc,
+				  0, 1, size, size, 0, 0);
+		xsync(t->real.dpy, real.draw);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		printf(" %3dx%-3d:%8.0f", size, size,
+		       n / elapsed(&start, &end));
+	}
+	printf(" requests/s\n");
+
+	XFreeGC(t->real.dpy, gc);
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		scroll_tests(&test, 64, 8, t);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
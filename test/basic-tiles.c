@@ -0,0 +1,259 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Tiled and stippled rectangle fills, as used by legacy toolkits for
+ * their backgrounds and hatchings. First check that we match the
+ * reference server for patterns of every small size, including after
+ * modifying a pattern that has already been used, then time how
+ * quickly we fill lots of small rectangles.
+ */
+
+static const int sizes[] = { 1, 2, 3, 4, 5, 8, 16 };
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static void random_pattern(uint32_t *pixels, int w, int h, int depth)
+{
+	int i;
+
+	for (i = 0; i < w*h; i++)
+		pixels[i] = rand() & depth_mask(depth);
+}
+
+static void draw_pattern(struct test_display *dpy, Pixmap pattern,
+			 const uint32_t *pixels, int w, int h)
+{
+	GC gc;
+	int x, y;
+
+	gc = XCreateGC(dpy->dpy, pattern, 0, NULL);
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			XSetForeground(dpy->dpy, gc, pixels[y*w + x]);
+			XDrawPoint(dpy->dpy, pattern, gc, x, y);
+		}
+	}
+	XFreeGC(dpy->dpy, gc);
+}
+
+static Pixmap create_pattern(struct test_display *dpy, struct test_target *tt,
+			     const uint32_t *pixels, int w, int h, int depth)
+{
+	Pixmap pattern;
+
+	pattern = XCreatePixmap(dpy->dpy, tt->draw, w, h, depth);
+	draw_pattern(dpy, pattern, pixels, w, h);
+
+	return pattern;
+}
+
+static GC create_gc(struct test_display *dpy, struct test_target *tt,
+		    int alu, int style, Pixmap pattern, int ox, int oy)
+{
+	XGCValues val;
+	unsigned long mask;
+
+	val.function = alu;
+	val.foreground = rand();
+	val.background = rand();
+	val.fill_style = style;
+	val.ts_x_origin = ox;
+	val.ts_y_origin = oy;
+	mask = GCFunction | GCForeground | GCBackground | GCFillStyle |
+		GCTileStipXOrigin | GCTileStipYOrigin;
+	if (style == FillTiled) {
+		val.tile = pattern;
+		mask |= GCTile;
+	} else {
+		val.stipple = pattern;
+		mask |= GCStipple;
+	}
+
+	return XCreateGC(dpy->dpy, tt->draw, mask, &val);
+}
+
+static int random_rects(XRectangle *r, int n, int size, int max)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		r[i].x = rand() % size - max/2;
+		r[i].y = rand() % size - max/2;
+		r[i].width = 1 + rand() % max;
+		r[i].height = 1 + rand() % max;
+	}
+
+	return n;
+}
+
+static void fill(struct test *t,
+		 struct test_target *real, Pixmap real_pattern,
+		 struct test_target *ref, Pixmap ref_pattern,
+		 int style)
+{
+	XRectangle r[64];
+	int alu = rand() % (GXset + 1);
+	int ox = rand() % 32 - 16, oy = rand() % 32 - 16;
+	int n = random_rects(r, 1 + rand() % 64, real->width,
+			     rand() & 1 ? 16 : real->width);
+	unsigned seed = rand();
+	GC gc;
+
+	srand(seed);
+	gc = create_gc(&t->real, real, alu, style, real_pattern, ox, oy);
+	XFillRectangles(t->real.dpy, real->draw, gc, r, n);
+	XFreeGC(t->real.dpy, gc);
+
+	srand(seed);
+	gc = create_gc(&t->ref, ref, alu, style, ref_pattern, ox, oy);
+	XFillRectangles(t->ref.dpy, ref->draw, gc, r, n);
+	XFreeGC(t->ref.dpy, gc);
+}
+
+static void pattern_tests(struct test *t, int reps, enum target target)
+{
+	struct test_target real, ref;
+	uint32_t pixels[16*16];
+	char buf[1024];
+	int style, w, h, r;
+
+	printf("Testing tiled and stippled fills (%s): ",
+	       test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (style = FillTiled; style <= FillOpaqueStippled; style++) {
+		int depth = style == FillTiled ? real.format->depth : 1;
+
+		for (w = 0; w < (int)ARRAY_SIZE(sizes); w++) {
+			for (h = 0; h < (int)ARRAY_SIZE(sizes); h++) {
+				Pixmap real_pattern, ref_pattern;
+
+				random_pattern(pixels, sizes[w], sizes[h], depth);
+				real_pattern = create_pattern(&t->real, &real, pixels,
+							      sizes[w], sizes[h], depth);
+				ref_pattern = create_pattern(&t->ref, &ref, pixels,
+							     sizes[w], sizes[h], depth);
+
+				for (r = 0; r < reps; r++) {
+					clear(&t->real, &real);
+					clear(&t->ref, &ref);
+
+					fill(t, &real, real_pattern, &ref, ref_pattern, style);
+
+					/* Modify the pattern after use, and reuse */
+					if (r & 1) {
+						random_pattern(pixels, sizes[w], sizes[h], depth);
+						draw_pattern(&t->real, real_pattern, pixels,
+							     sizes[w], sizes[h]);
+						draw_pattern(&t->ref, ref_pattern, pixels,
+							     sizes[w], sizes[h]);
+
+						fill(t, &real, real_pattern, &ref, ref_pattern, style);
+					}
+
+					sprintf(buf, "style=%d, pattern=%dx%d, rep=%d",
+						style, sizes[w], sizes[h], r);
+					test_compare(t,
+						     real.draw, real.format,
+						     ref.draw, ref.format,
+						     0, 0, real.width, real.height,
+						     buf);
+				}
+
+				XFreePixmap(t->real.dpy, real_pattern);
+				XFreePixmap(t->ref.dpy, ref_pattern);
+			}
+		}
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations x %d]\n",
+	       reps, (int)(ARRAY_SIZE(sizes) * ARRAY_SIZE(sizes)));
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	static const char *names[] = { "tiled", "stippled", "opaque" };
+	struct test_target real;
+	XRectangle r[1024];
+	uint32_t pixels[16*16];
+	int style, size, n;
+
+	printf("Timing small tiled and stippled fills (%s):\n",
+	       test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+
+	for (style = FillTiled; style <= FillOpaqueStippled; style++) {
+		int depth = style == FillTiled ? real.format->depth : 1;
+
+		printf("  %-9s", names[style - FillTiled]);
+		for (size = 2; size <= 16; size <<= 1) {
+			struct timespec start, end;
+			Pixmap pattern;
+			GC gc;
+			int i, j;
+
+			random_pattern(pixels, size, size, depth);
+			pattern = create_pattern(&t->real, &real, pixels,
+						 size, size, depth);
+
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (i = 0; i < 10; i++) {
+				/* A fresh GC for each batch, as toolkits do */
+				gc = create_gc(&t->real, &real, GXcopy, style,
+					       pattern, 0, 0);
+				for (j = 0; j < 10; j++) {
+					n = random_rects(r, ARRAY_SIZE(r),
+							 real.width, 16);
+					XFillRectangles(t->real.dpy, real.draw,
+							gc, r, n);
+				}
+				XFreeGC(t->real.dpy, gc);
+			}
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			XFreePixmap(t->real.dpy, pattern);
+
+			printf(" %2dx%-2d:%8.0f", size, size,
+			       100 * ARRAY_SIZE(r) / elapsed(&start, &end));
+		}
+		printf(" rects/s\n");
+	}
+
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		pattern_tests(&test, 4, t);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
@@ -0,0 +1,288 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Horizontal and vertical wide lines, solid and dashed, as drawn by
+ * CAD and plotting clients. First check that we match the reference
+ * server for each line width, cap, join and dash pattern, then time
+ * how quickly we draw a screenful of them.
+ */
+
+struct dash {
+	const char *name;
+	int len;
+	char list[4];
+};
+
+static const struct dash dashes[] = {
+	{ "solid", 0, { 0 } },
+	{ "dot", 2, { 1, 1 } },
+	{ "dash", 2, { 4, 4 } },
+	{ "long", 2, { 12, 4 } },
+	{ "dash-dot", 4, { 8, 3, 2, 3 } },
+	{ "odd", 3, { 5, 2, 3 } },
+};
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static GC create_gc(struct test_display *dpy, struct test_target *tt,
+		    int alu, int width, int style, int cap, int join,
+		    const struct dash *dash, int offset)
+{
+	XGCValues val;
+	GC gc;
+
+	val.function = alu;
+	val.foreground = WhitePixel(dpy->dpy, 0);
+	val.background = 0x7f7f7f;
+	val.line_width = width;
+	val.line_style = dash->len ? style : LineSolid;
+	val.cap_style = cap;
+	val.join_style = join;
+
+	gc = XCreateGC(dpy->dpy, tt->draw,
+		       GCForeground |
+		       GCBackground |
+		       GCFunction |
+		       GCLineWidth |
+		       GCLineStyle |
+		       GCCapStyle |
+		       GCJoinStyle,
+		       &val);
+	if (dash->len)
+		XSetDashes(dpy->dpy, gc, offset, dash->list, dash->len);
+
+	return gc;
+}
+
+static int random_segments(XSegment *seg, int n, int size)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int a = rand() % size, b = rand() % size, c = rand() % size;
+
+		if (rand() & 1) {
+			seg[i].x1 = a; seg[i].x2 = b;
+			seg[i].y1 = seg[i].y2 = c;
+		} else {
+			seg[i].y1 = a; seg[i].y2 = b;
+			seg[i].x1 = seg[i].x2 = c;
+		}
+	}
+
+	return n;
+}
+
+static int random_polyline(XPoint *pt, int n, int size)
+{
+	int i;
+
+	pt[0].x = rand() % size;
+	pt[0].y = rand() % size;
+	for (i = 1; i < n; i++) {
+		pt[i] = pt[i-1];
+		if (i & 1)
+			pt[i].x = rand() % size;
+		else
+			pt[i].y = rand() % size;
+	}
+
+	return n;
+}
+
+static void segment_tests(struct test *t, int reps, enum target target)
+{
+	struct test_target real, ref;
+	XSegment seg[16];
+	char buf[1024];
+	int d, lw, cap, style, r;
+
+	printf("Testing wide rectilinear segments (%s): ",
+	       test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (d = 0; d < (int)ARRAY_SIZE(dashes); d++) {
+		for (style = LineOnOffDash; style <= LineDoubleDash; style++) {
+			if (dashes[d].len == 0 && style != LineOnOffDash)
+				continue;
+
+			for (cap = CapNotLast; cap <= CapProjecting; cap++) {
+				for (lw = 1; lw <= 20; lw++) {
+					for (r = 0; r < reps; r++) {
+						int alu = rand() % (GXset + 1);
+						int offset = rand() % 16;
+						int n = random_segments(seg, 1 + rand() % 16,
+									real.width);
+						GC gc;
+
+						sprintf(buf,
+							"dash=%s, style=%d, width=%d, cap=%d, alu=%d, offset=%d",
+							dashes[d].name, style, lw, cap, alu, offset);
+
+						clear(&t->real, &real);
+						clear(&t->ref, &ref);
+
+						gc = create_gc(&t->real, &real, alu, lw, style,
+							       cap, JoinMiter, &dashes[d], offset);
+						XDrawSegments(t->real.dpy, real.draw, gc, seg, n);
+						XFreeGC(t->real.dpy, gc);
+
+						gc = create_gc(&t->ref, &ref, alu, lw, style,
+							       cap, JoinMiter, &dashes[d], offset);
+						XDrawSegments(t->ref.dpy, ref.draw, gc, seg, n);
+						XFreeGC(t->ref.dpy, gc);
+
+						test_compare(t,
+							     real.draw, real.format,
+							     ref.draw, ref.format,
+							     0, 0, real.width, real.height,
+							     buf);
+					}
+				}
+			}
+		}
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations]\n", reps);
+}
+
+static void polyline_tests(struct test *t, int reps, enum target target)
+{
+	struct test_target real, ref;
+	XPoint pt[16];
+	char buf[1024];
+	int lw, cap, join, r;
+
+	printf("Testing wide rectilinear polylines (%s): ",
+	       test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (join = JoinMiter; join <= JoinBevel; join++) {
+		for (cap = CapNotLast; cap <= CapProjecting; cap++) {
+			for (lw = 1; lw <= 20; lw++) {
+				for (r = 0; r < reps; r++) {
+					int alu = r & 1 ? GXcopy : rand() % (GXset + 1);
+					int n = random_polyline(pt, 2 + rand() % 15,
+								real.width);
+					GC gc;
+
+					/* Close some of the polylines */
+					if (rand() & 1)
+						pt[n-1] = pt[0];
+
+					sprintf(buf,
+						"n=%d, width=%d, cap=%d, join=%d, alu=%d",
+						n, lw, cap, join, alu);
+
+					clear(&t->real, &real);
+					clear(&t->ref, &ref);
+
+					gc = create_gc(&t->real, &real, alu, lw, LineSolid,
+						       cap, join, &dashes[0], 0);
+					XDrawLines(t->real.dpy, real.draw, gc,
+						   pt, n, CoordModeOrigin);
+					XFreeGC(t->real.dpy, gc);
+
+					gc = create_gc(&t->ref, &ref, alu, lw, LineSolid,
+						       cap, join, &dashes[0], 0);
+					XDrawLines(t->ref.dpy, ref.draw, gc,
+						   pt, n, CoordModeOrigin);
+					XFreeGC(t->ref.dpy, gc);
+
+					test_compare(t,
+						     real.draw, real.format,
+						     ref.draw, ref.format,
+						     0, 0, real.width, real.height,
+						     buf);
+				}
+			}
+		}
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations]\n", reps);
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	struct test_target real;
+	XSegment seg[1024];
+	int d, lw, n;
+
+	printf("Timing wide rectilinear segments (%s):\n",
+	       test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+	n = random_segments(seg, ARRAY_SIZE(seg), real.width);
+
+	for (d = 0; d < (int)ARRAY_SIZE(dashes); d++) {
+		printf("  %-10s", dashes[d].name);
+		for (lw = 1; lw <= 20; lw++) {
+			struct timespec start, end;
+			GC gc;
+			int i;
+
+			if (lw > 4 && lw & 3)
+				continue;
+
+			gc = create_gc(&t->real, &real, GXcopy, lw,
+				       LineOnOffDash, CapButt, JoinMiter,
+				       &dashes[d], 0);
+
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (i = 0; i < 10; i++)
+				XDrawSegments(t->real.dpy, real.draw, gc, seg, n);
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			XFreeGC(t->real.dpy, gc);
+
+			printf(" %2d:%7.0f", lw,
+			       10 * n / elapsed(&start, &end));
+		}
+		printf(" segments/s\n");
+	}
+
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++) {
+		segment_tests(&test, 4, t);
+		polyline_tests(&test, 8, t);
+	}
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
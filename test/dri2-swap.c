@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 
 #include <xf86drm.h>
 #include <drm.h>
@@ -75,6 +76,53 @@ static double elapsed(const struct timespec *start,
 		1e-9*(end->tv_nsec - start->tv_nsec);
 }
 
+static void pacing(Display *dpy, Window win, const char *name,
+		   int width, int height)
+{
+	struct timespec last, now;
+	uint64_t ust, msc, sbc, last_msc;
+	unsigned int hist[4] = { 0, 0, 0, 0 };
+	double t, min, max, sum, sum2;
+	int count;
+
+	xsync(dpy, win);
+	DRI2GetMSC(dpy, win, &ust, &last_msc, &sbc);
+	clock_gettime(CLOCK_MONOTONIC, &last);
+
+	min = 1e9; max = sum = sum2 = 0;
+	for (count = 0; count < COUNT; count++) {
+		DRI2SwapBuffers(dpy, win, 0, 0, 0);
+		xsync(dpy, win);
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		DRI2GetMSC(dpy, win, &ust, &msc, &sbc);
+
+		t = elapsed(&last, &now);
+		if (t < min)
+			min = t;
+		if (t > max)
+			max = t;
+		sum += t;
+		sum2 += t*t;
+
+		/* vblanks between consecutive swaps: 0 means we are
+		 * running ahead of the display, 2 or more means we
+		 * missed a frame.
+		 */
+		msc -= last_msc;
+		hist[msc < 3 ? msc : 3]++;
+
+		last = now;
+		last_msc += msc;
+	}
+
+	sum /= count;
+	printf("%d %s (%dx%d) frame pacing: interval min %.3fms, mean %.3fms, max %.3fms, stddev %.3fms; vblanks per swap 0:%u 1:%u 2:%u 3+:%u\n",
+	       count, name, width, height,
+	       1e3*min, 1e3*sum, 1e3*max, 1e3*sqrt(sum2/count - sum*sum),
+	       hist[0], hist[1], hist[2], hist[3]);
+}
+
 static void run(Display *dpy, int width, int height,
 		unsigned int *attachments, int nattachments,
 		const char *name)
@@ -114,6 +162,8 @@ static void run(Display *dpy, int width, int height,
 	printf("%d %s (%dx%d) swaps in %fs.\n",
 	       count, name, width, height, elapsed(&start, &end));
 
+	pacing(dpy, win, name, width, height);
+
 	xsync(dpy, win);
 	clock_gettime(CLOCK_MONOTONIC, &start);
 	for (count = 0; count < COUNT; count++)
@@ -0,0 +1,163 @@
+/* Replay a pixmap migration trace, as recorded by the DebugMigrationTrace
+ * option, against each of the migration policies and report how much
+ * traffic each would have generated.
+ *
+ * The replay is necessarily approximate: when a policy refuses a
+ * migration that was allowed whilst recording, we simply drop the
+ * uploads that immediately followed for that pixmap and carry on with
+ * the rest of the trace as recorded.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sna_migrate.h"
+
+#define HASH_SIZE 4096
+#define PINGPONG_WINDOW 100 /* ms */
+
+struct pixmap {
+	struct pixmap *next;
+	uint32_t serial;
+	struct sna_migrate_history history;
+	uint32_t refused_time;
+	int refused;
+};
+
+struct replay {
+	const struct sna_migrate_policy *policy;
+	struct pixmap *hash[HASH_SIZE];
+	unsigned count[2], pingpong, refused, dropped;
+	uint64_t bytes[2], saved;
+};
+
+static struct pixmap *lookup(struct replay *r, uint32_t serial)
+{
+	struct pixmap **head = &r->hash[serial % HASH_SIZE], *p;
+
+	for (p = *head; p; p = p->next)
+		if (p->serial == serial)
+			return p;
+
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		abort();
+
+	p->serial = serial;
+	p->next = *head;
+	*head = p;
+	return p;
+}
+
+static void replay_record(struct replay *r, const struct sna_migration *rec)
+{
+	struct sna_migration m = *rec;
+	struct pixmap *p = lookup(r, m.pixmap);
+
+	if (m.optional) {
+		if (!sna_migrate_decide(r->policy, &p->history, &m)) {
+			p->refused = 1;
+			p->refused_time = m.time;
+			r->refused++;
+		} else
+			p->refused = 0;
+		return;
+	}
+
+	/* Drop the upload that followed a decision we refused */
+	if (p->refused && m.dir == MIGRATE_TO_GPU && m.time == p->refused_time) {
+		r->dropped++;
+		r->saved += m.bytes;
+		return;
+	}
+	p->refused = 0;
+
+	if (p->history.valid &&
+	    p->history.dir != m.dir &&
+	    m.time - p->history.time < PINGPONG_WINDOW)
+		r->pingpong++;
+
+	sna_migrate_update(r->policy, &p->history, &m);
+	r->count[m.dir]++;
+	r->bytes[m.dir] += m.bytes;
+}
+
+static void replay_fini(struct replay *r)
+{
+	int i;
+
+	for (i = 0; i < HASH_SIZE; i++) {
+		while (r->hash[i]) {
+			struct pixmap *p = r->hash[i];
+			r->hash[i] = p->next;
+			free(p);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const struct sna_migrate_policy *all[] = {
+		&sna_migrate_greedy,
+		&sna_migrate_hysteresis,
+	};
+	struct replay *replays;
+	struct sna_migration m;
+	char reason[128];
+	int nreplay, n;
+	FILE *file;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s trace [policy...]\n", argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "r");
+	if (file == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	nreplay = argc > 2 ? argc - 2 : (int)(sizeof(all)/sizeof(all[0]));
+	replays = calloc(nreplay, sizeof(*replays));
+	if (replays == NULL)
+		return 1;
+
+	for (n = 0; n < nreplay; n++) {
+		if (argc > 2) {
+			replays[n].policy = sna_migrate_policy_lookup(argv[n + 2]);
+			if (replays[n].policy == NULL) {
+				fprintf(stderr, "unknown policy '%s'\n", argv[n + 2]);
+				return 1;
+			}
+		} else
+			replays[n].policy = all[n];
+	}
+
+	while (sna_migrate_trace_read(file, &m, reason, sizeof(reason)))
+		for (n = 0; n < nreplay; n++)
+			replay_record(&replays[n], &m);
+	fclose(file);
+
+	printf("%-12s %10s %12s %10s %12s %10s %10s %12s\n",
+	       "policy", "to-gpu", "gpu-KiB", "to-cpu", "cpu-KiB",
+	       "ping-pong", "refused", "saved-KiB");
+	for (n = 0; n < nreplay; n++) {
+		struct replay *r = &replays[n];
+
+		printf("%-12s %10u %12llu %10u %12llu %10u %10u %12llu\n",
+		       r->policy->name,
+		       r->count[MIGRATE_TO_GPU],
+		       (unsigned long long)(r->bytes[MIGRATE_TO_GPU] >> 10),
+		       r->count[MIGRATE_TO_CPU],
+		       (unsigned long long)(r->bytes[MIGRATE_TO_CPU] >> 10),
+		       r->pingpong, r->refused,
+		       (unsigned long long)(r->saved >> 10));
+		replay_fini(r);
+	}
+
+	free(replays);
+	return 0;
+}
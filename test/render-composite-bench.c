@@ -0,0 +1,338 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Measure the throughput of Composite over a standard matrix of
+ * operator, source, mask and destination format, size and source
+ * repeat or transform, reporting operations and pixels per second for
+ * each case as comma-separated values. Run it once for each backend
+ * (SNA, UXA or plain fb) or driver version, labelling the results with
+ * -l, and concatenate the files to compare them:
+ *
+ *   render-composite-bench -l uxa -o uxa.csv
+ *
+ * Each case is timed for at least -t milliseconds (default 50).
+ */
+
+#define MAX_SIZE 512
+#define TILE_SIZE 16
+
+enum format { A8R8G8B8, X8R8G8B8, R5G6B5, A8, NUM_FORMATS };
+static const char *format_names[NUM_FORMATS] = {
+	"a8r8g8b8", "x8r8g8b8", "r5g6b5", "a8"
+};
+
+enum mode { MODE_NONE, MODE_REPEAT, MODE_TRANSFORM, NUM_MODES };
+static const char *mode_names[NUM_MODES] = { "none", "repeat", "transform" };
+
+enum { MASK_ALPHA = 1, MASK_COMPONENT, NUM_MASKS };
+static const char *mask_names[NUM_MASKS] = { "none", "a8", "ca" };
+
+static const struct {
+	const char *name;
+	int op;
+} ops[] = {
+	{ "src", PictOpSrc },
+	{ "over", PictOpOver },
+	{ "add", PictOpAdd },
+};
+
+static const int sizes[] = { 8, 32, 128, 512 };
+
+struct bench {
+	struct test_display *dpy;
+	/* source 0 is a solid fill, the rest follow enum format */
+	Picture src[NUM_FORMATS + 1][NUM_MODES];
+	Picture mask[NUM_MASKS];
+	Picture dst[NUM_FORMATS];
+	Pixmap dst_pixmap[NUM_FORMATS];
+};
+
+static XRenderPictFormat *find_format(Display *dpy, enum format f)
+{
+	XRenderPictFormat tmpl;
+
+	switch (f) {
+	case A8R8G8B8:
+		return XRenderFindStandardFormat(dpy, PictStandardARGB32);
+	case X8R8G8B8:
+		return XRenderFindStandardFormat(dpy, PictStandardRGB24);
+	case A8:
+		return XRenderFindStandardFormat(dpy, PictStandardA8);
+	case R5G6B5:
+		memset(&tmpl, 0, sizeof(tmpl));
+		tmpl.type = PictTypeDirect;
+		tmpl.depth = 16;
+		tmpl.direct.red = 11;
+		tmpl.direct.redMask = 0x1f;
+		tmpl.direct.green = 5;
+		tmpl.direct.greenMask = 0x3f;
+		tmpl.direct.blue = 0;
+		tmpl.direct.blueMask = 0x1f;
+		return XRenderFindFormat(dpy,
+					 PictFormatType | PictFormatDepth |
+					 PictFormatRed | PictFormatRedMask |
+					 PictFormatGreen | PictFormatGreenMask |
+					 PictFormatBlue | PictFormatBlueMask |
+					 PictFormatAlphaMask,
+					 &tmpl, 0);
+	default:
+		return NULL;
+	}
+}
+
+static void random_color(XRenderColor *color)
+{
+	color->alpha = rand() & 0xffff;
+	color->red = (rand() & 0xffff) * color->alpha / 0xffff;
+	color->green = (rand() & 0xffff) * color->alpha / 0xffff;
+	color->blue = (rand() & 0xffff) * color->alpha / 0xffff;
+}
+
+static Picture create_picture(struct test_display *t,
+			      XRenderPictFormat *format,
+			      int width, int height,
+			      unsigned long mask,
+			      XRenderPictureAttributes *pa,
+			      Pixmap *out)
+{
+	XRenderColor color;
+	Picture picture;
+	Pixmap pixmap;
+	int i;
+
+	pixmap = XCreatePixmap(t->dpy, t->root, width, height, format->depth);
+	picture = XRenderCreatePicture(t->dpy, pixmap, format, mask, pa);
+
+	random_color(&color);
+	XRenderFillRectangle(t->dpy, PictOpSrc, picture, &color,
+			     0, 0, width, height);
+	for (i = 0; i < 16; i++) {
+		random_color(&color);
+		XRenderFillRectangle(t->dpy, PictOpSrc, picture, &color,
+				     rand() % width, rand() % height,
+				     1 + rand() % width, 1 + rand() % height);
+	}
+
+	if (out)
+		*out = pixmap;
+	else
+		XFreePixmap(t->dpy, pixmap);
+	return picture;
+}
+
+static Picture create_source(struct test_display *t,
+			     XRenderPictFormat *format,
+			     enum mode mode)
+{
+	XRenderPictureAttributes pa;
+	XTransform transform;
+	Picture picture;
+
+	switch (mode) {
+	case MODE_NONE:
+		return create_picture(t, format, MAX_SIZE, MAX_SIZE,
+				      0, NULL, NULL);
+
+	case MODE_REPEAT:
+		pa.repeat = RepeatNormal;
+		return create_picture(t, format, TILE_SIZE, TILE_SIZE,
+				      CPRepeat, &pa, NULL);
+
+	case MODE_TRANSFORM:
+		/* Downscale by a factor of two with bilinear filtering */
+		picture = create_picture(t, format, 2*MAX_SIZE, 2*MAX_SIZE,
+					 0, NULL, NULL);
+
+		memset(&transform, 0, sizeof(transform));
+		transform.matrix[0][0] = XDoubleToFixed(2);
+		transform.matrix[1][1] = XDoubleToFixed(2);
+		transform.matrix[2][2] = XDoubleToFixed(1);
+		XRenderSetPictureTransform(t->dpy, picture, &transform);
+		XRenderSetPictureFilter(t->dpy, picture,
+					FilterBilinear, NULL, 0);
+		return picture;
+
+	default:
+		return None;
+	}
+}
+
+static void bench_init(struct bench *b, struct test_display *t)
+{
+	XRenderPictFormat *format;
+	XRenderPictureAttributes pa;
+	XRenderColor color;
+	int f, m;
+
+	memset(b, 0, sizeof(*b));
+	b->dpy = t;
+
+	random_color(&color);
+	b->src[0][MODE_NONE] = XRenderCreateSolidFill(t->dpy, &color);
+
+	for (f = 0; f < NUM_FORMATS; f++) {
+		format = find_format(t->dpy, f);
+		if (format == NULL)
+			continue;
+
+		for (m = 0; m < NUM_MODES; m++)
+			b->src[f + 1][m] = create_source(t, format, m);
+
+		b->dst[f] = create_picture(t, format, MAX_SIZE, MAX_SIZE,
+					   0, NULL, &b->dst_pixmap[f]);
+	}
+
+	b->mask[MASK_ALPHA] =
+		create_picture(t, find_format(t->dpy, A8),
+			       MAX_SIZE, MAX_SIZE, 0, NULL, NULL);
+
+	pa.component_alpha = 1;
+	b->mask[MASK_COMPONENT] =
+		create_picture(t, find_format(t->dpy, A8R8G8B8),
+			       MAX_SIZE, MAX_SIZE, CPComponentAlpha, &pa, NULL);
+}
+
+static void bench_fini(struct bench *b)
+{
+	Display *dpy = b->dpy->dpy;
+	int f, m;
+
+	for (f = 0; f <= NUM_FORMATS; f++)
+		for (m = 0; m < NUM_MODES; m++)
+			if (b->src[f][m])
+				XRenderFreePicture(dpy, b->src[f][m]);
+
+	for (m = 0; m < NUM_MASKS; m++)
+		if (b->mask[m])
+			XRenderFreePicture(dpy, b->mask[m]);
+
+	for (f = 0; f < NUM_FORMATS; f++) {
+		if (b->dst[f]) {
+			XRenderFreePicture(dpy, b->dst[f]);
+			XFreePixmap(dpy, b->dst_pixmap[f]);
+		}
+	}
+}
+
+/* Repeat the composite in ever larger batches until at least @target
+ * seconds have passed, waiting for the GPU after each batch.
+ */
+static double run(struct bench *b, int op,
+		  Picture src, Picture mask, int dst, int size,
+		  double target, long *count)
+{
+	struct test_display *t = b->dpy;
+	struct timespec start, end;
+	long i, n = 0, batch = 16;
+	int range = MAX_SIZE - size + 1;
+	double secs;
+
+	xsync(t->dpy, b->dst_pixmap[dst]);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		for (i = n; i < n + batch; i++) {
+			int x = i * 7 % range;
+			int y = i * 13 % range;
+
+			XRenderComposite(t->dpy, op, src, mask, b->dst[dst],
+					 x, y, x, y, x, y, size, size);
+		}
+		n += batch;
+		if (batch < 1 << 16)
+			batch *= 2;
+
+		xsync(t->dpy, b->dst_pixmap[dst]);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		secs = elapsed(&start, &end);
+	} while (secs < target);
+
+	*count = n;
+	return secs;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-d display] [-l label] [-o output.csv] [-t msecs]\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	struct bench b;
+	const char *label = "default";
+	const char *output = NULL;
+	double target = 0.05;
+	FILE *out = stdout;
+	int i, o, s, m, d, z, mode;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			label = argv[++i];
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			target = atoi(argv[++i]) / 1000.;
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			i++;
+		else if (strncmp(argv[i], "-d", 2))
+			usage(argv[0]);
+	}
+
+	test_init_real(&test, argc, argv);
+
+	if (output) {
+		out = fopen(output, "w");
+		if (out == NULL)
+			die("unable to open %s for writing\n", output);
+	}
+
+	bench_init(&b, &test.real);
+
+	fprintf(out, "# %s, vendor release %d\n",
+		ServerVendor(test.real.dpy), VendorRelease(test.real.dpy));
+	fprintf(out, "label,op,src,mask,dst,size,mode,count,seconds,ops_per_sec,pixels_per_sec\n");
+
+	for (o = 0; o < (int)ARRAY_SIZE(ops); o++)
+	for (s = 0; s <= NUM_FORMATS; s++)
+	for (m = 0; m < NUM_MASKS; m++)
+	for (d = 0; d < NUM_FORMATS; d++)
+	for (z = 0; z < (int)ARRAY_SIZE(sizes); z++)
+	for (mode = 0; mode < NUM_MODES; mode++) {
+		Picture src = b.src[s][mode];
+		long count;
+		double secs;
+
+		if (src == None || b.dst[d] == None)
+			continue;
+
+		secs = run(&b, ops[o].op, src, b.mask[m], d, sizes[z],
+			   target, &count);
+
+		fprintf(out, "%s,%s,%s,%s,%s,%d,%s,%ld,%.6f,%.1f,%.1f\n",
+			label, ops[o].name,
+			s ? format_names[s - 1] : "solid",
+			mask_names[m], format_names[d],
+			sizes[z], mode_names[mode],
+			count, secs,
+			count / secs,
+			(double)count * sizes[z] * sizes[z] / secs);
+		fflush(out);
+	}
+
+	bench_fini(&b);
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <X11/Xutil.h> /* for XDestroyImage */
+
+#include "test.h"
+
+/* Lots of tiny composites cycling through a handful of source and mask
+ * pictures, as when drawing icons and widget decorations, so that the
+ * cost of setting up each composite dominates. First check that we
+ * match the reference server, then time how many composites we can
+ * process as the number of distinct pictures grows.
+ */
+
+#define NUM_PICTURES 8
+
+struct pictures {
+	Pixmap pixmap[NUM_PICTURES];
+	Picture picture[NUM_PICTURES];
+};
+
+static void clear(struct test_display *dpy, struct test_target *tt)
+{
+	XRenderColor render_color = {0};
+	XRenderFillRectangle(dpy->dpy, PictOpClear, tt->picture, &render_color,
+			     0, 0, tt->width, tt->height);
+}
+
+static void random_color(XRenderColor *color)
+{
+	color->alpha = rand() & 0xffff;
+	color->red = (rand() & 0xffff) * color->alpha / 0xffff;
+	color->green = (rand() & 0xffff) * color->alpha / 0xffff;
+	color->blue = (rand() & 0xffff) * color->alpha / 0xffff;
+}
+
+static void create_pictures(struct test_display *dpy, struct pictures *p,
+			    unsigned seed)
+{
+	XRenderPictFormat *format[2];
+	int i, j;
+
+	format[0] = XRenderFindStandardFormat(dpy->dpy, PictStandardARGB32);
+	format[1] = XRenderFindStandardFormat(dpy->dpy, PictStandardA8);
+
+	srand(seed);
+	for (i = 0; i < NUM_PICTURES; i++) {
+		XRenderPictFormat *f = format[i & 1];
+		XRenderPictureAttributes pa;
+
+		pa.repeat = i & 2 ? RepeatNormal : RepeatNone;
+		p->pixmap[i] = XCreatePixmap(dpy->dpy, dpy->root,
+					     32, 32, f->depth);
+		p->picture[i] = XRenderCreatePicture(dpy->dpy, p->pixmap[i],
+						     f, CPRepeat, &pa);
+
+		for (j = 0; j < 16; j++) {
+			XRenderColor color;
+
+			random_color(&color);
+			XRenderFillRectangle(dpy->dpy, PictOpSrc,
+					     p->picture[i], &color,
+					     rand() % 32, rand() % 32,
+					     1 + rand() % 32, 1 + rand() % 32);
+		}
+	}
+}
+
+static void destroy_pictures(struct test_display *dpy, struct pictures *p)
+{
+	int i;
+
+	for (i = 0; i < NUM_PICTURES; i++) {
+		XRenderFreePicture(dpy->dpy, p->picture[i]);
+		XFreePixmap(dpy->dpy, p->pixmap[i]);
+	}
+}
+
+static void composite(struct test_display *dpy, struct test_target *tt,
+		      struct pictures *p, int op,
+		      int src, int mask, int x, int y, int w, int h)
+{
+	XRenderComposite(dpy->dpy, op,
+			 p->picture[src],
+			 mask < 0 ? None : p->picture[mask],
+			 tt->picture,
+			 x, y, y, x,
+			 x, y, w, h);
+}
+
+static void setup_tests(struct test *t, int reps, int sets, enum target target)
+{
+	struct test_target real, ref;
+	struct pictures real_p, ref_p;
+	char buf[1024];
+	int r, s;
+
+	printf("Testing composite setup (%s): ", test_target_name(target));
+	fflush(stdout);
+
+	test_target_create_render(&t->real, target, &real);
+	test_target_create_render(&t->ref, target, &ref);
+
+	for (s = 0; s < sets; s++) {
+		unsigned seed = rand();
+		int n = 1 + rand() % NUM_PICTURES;
+
+		create_pictures(&t->real, &real_p, seed);
+		create_pictures(&t->ref, &ref_p, seed);
+
+		clear(&t->real, &real);
+		clear(&t->ref, &ref);
+
+		for (r = 0; r < reps; r++) {
+			int op = rand() & 1 ? PictOpOver : PictOpAdd;
+			int src = rand() % n;
+			int mask = rand() & 1 ? rand() % n : -1;
+			int w = 1 + rand() % 32;
+			int h = 1 + rand() % 32;
+			int x = rand() % (real.width - w);
+			int y = rand() % (real.height - h);
+
+			composite(&t->real, &real, &real_p, op, src, mask, x, y, w, h);
+			composite(&t->ref, &ref, &ref_p, op, src, mask, x, y, w, h);
+		}
+
+		sprintf(buf, "set=%d, pictures=%d", s, n);
+		test_compare(t,
+			     real.draw, real.format,
+			     ref.draw, ref.format,
+			     0, 0, real.width, real.height,
+			     buf);
+
+		destroy_pictures(&t->real, &real_p);
+		destroy_pictures(&t->ref, &ref_p);
+	}
+
+	test_target_destroy_render(&t->real, &real);
+	test_target_destroy_render(&t->ref, &ref);
+
+	printf("passed [%d iterations x %d]\n", reps, sets);
+}
+
+static void benchmark(struct test *t, enum target target)
+{
+	struct test_target real;
+	struct pictures p;
+	int mask, n;
+
+	printf("Timing composite setup (%s):\n", test_target_name(target));
+
+	test_target_create_render(&t->real, target, &real);
+	create_pictures(&t->real, &p, 0);
+
+	for (mask = 0; mask <= 1; mask++) {
+		printf("  %-8s", mask ? "mask" : "no mask");
+		for (n = 1; n <= NUM_PICTURES; n <<= 1) {
+			struct timespec start, end;
+			int i, count = 20000;
+
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (i = 0; i < count; i++)
+				composite(&t->real, &real, &p, PictOpOver,
+					  i % n, mask ? (i + 1) % n : -1,
+					  (i * 8) % (real.width - 8),
+					  (i / 64 * 8) % (real.height - 8),
+					  8, 8);
+			xsync(t->real.dpy, real.draw);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			printf(" %d:%8.0f", n, count / elapsed(&start, &end));
+		}
+		printf(" composites/s\n");
+	}
+
+	destroy_pictures(&t->real, &p);
+	test_target_destroy_render(&t->real, &real);
+}
+
+int main(int argc, char **argv)
+{
+	struct test test;
+	enum target t;
+
+	test_init(&test, argc, argv);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		setup_tests(&test, 256, 8, t);
+
+	for (t = TARGET_FIRST; t <= TARGET_LAST; t++)
+		benchmark(&test, t);
+
+	return 0;
+}
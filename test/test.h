@@ -2,6 +2,7 @@
 #define TEST_H
 
 #include <stdint.h>
+#include <time.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/XShm.h>
 #include <X11/extensions/Xrender.h>
@@ -39,12 +40,19 @@ void die(const char *fmt, ...);
 #define die_unless(expr) do{ if (!(expr)) die("verification failed: %s\n", #expr); } while(0)
 
 void test_init(struct test *test, int argc, char **argv);
+void test_init_real(struct test *test, int argc, char **argv);
 
 void test_compare(struct test *real,
 		  Drawable real_draw, XRenderPictFormat *real_format,
 		  Drawable ref_draw, XRenderPictFormat *ref_format,
 		  int x, int y, int w, int h, const char *info);
 
+/* Round-trip a 1x1 GetImage to wait until the server has finished
+ * rendering to @draw, for timing.
+ */
+void xsync(Display *dpy, Drawable draw);
+double elapsed(const struct timespec *start, const struct timespec *end);
+
 #define MAX_DELTA 3
 int pixel_difference(uint32_t a, uint32_t b);
 
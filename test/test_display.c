@@ -5,6 +5,8 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 
+#include <X11/Xutil.h> /* for XDestroyImage */
+
 #include "test.h"
 
 static Window get_root(struct test_display *t)
@@ -27,7 +29,7 @@ static Window get_root(struct test_display *t)
 	return w;
 }
 
-static Display *real_display(int argc, char **argv)
+static Display *real_display(int argc, char **argv, FILE *log)
 {
 	Display *dpy;
 	const char *name = NULL;
@@ -54,7 +56,7 @@ static Display *real_display(int argc, char **argv)
 	if (dpy == NULL)
 		die("unable to open real display %s\n", name);
 
-	printf("Opened connection to %s for testing.\n", name);
+	fprintf(log, "Opened connection to %s for testing.\n", name);
 	return dpy;
 }
 
@@ -131,7 +133,7 @@ static void test_get_displays(int argc, char **argv,
 			      struct test_display *real,
 			      struct test_display *ref)
 {
-	real->dpy = real_display(argc, argv);
+	real->dpy = real_display(argc, argv, stdout);
 	default_setup(real);
 	shm_setup(real);
 	real->root = get_root(real);
@@ -148,3 +150,33 @@ void test_init(struct test *test, int argc, char **argv)
 	memset(test, 0, sizeof(*test));
 	test_get_displays(argc, argv, &test->real, &test->ref);
 }
+
+/* Connect to the real display only, for benchmarks that have no need of
+ * a reference to compare against. Their results go to stdout, so report
+ * the connection on stderr instead.
+ */
+void test_init_real(struct test *test, int argc, char **argv)
+{
+	memset(test, 0, sizeof(*test));
+
+	test->real.dpy = real_display(argc, argv, stderr);
+	default_setup(&test->real);
+	shm_setup(&test->real);
+	test->real.root = get_root(&test->real);
+}
+
+void xsync(Display *dpy, Drawable draw)
+{
+	XImage *image;
+
+	image = XGetImage(dpy, draw, 0, 0, 1, 1, ~0, ZPixmap);
+	if (image)
+		XDestroyImage(image);
+}
+
+double elapsed(const struct timespec *start,
+	       const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) +
+		1e-9*(end->tv_nsec - start->tv_nsec);
+}
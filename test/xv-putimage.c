@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xvlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "test.h"
+
+#define FOURCC_I420 0x30323449
+#define FOURCC_YUY2 0x32595559
+
+#define COUNT 240
+
+static XvPortID find_port(Display *dpy, int id)
+{
+	XvAdaptorInfo *adaptors;
+	unsigned int nadaptors, i, j;
+	XvPortID port = 0;
+
+	if (XvQueryAdaptors(dpy, DefaultRootWindow(dpy),
+			    &nadaptors, &adaptors) != Success)
+		return 0;
+
+	for (i = 0; port == 0 && i < nadaptors; i++) {
+		XvImageFormatValues *formats;
+		int nformats, k;
+
+		if ((adaptors[i].type & XvImageMask) == 0)
+			continue;
+
+		formats = XvListImageFormats(dpy, adaptors[i].base_id,
+					     &nformats);
+		for (k = 0; k < nformats; k++)
+			if (formats[k].id == id)
+				break;
+		if (formats)
+			XFree(formats);
+		if (k == nformats)
+			continue;
+
+		for (j = 0; j < adaptors[i].num_ports; j++) {
+			if (XvGrabPort(dpy, adaptors[i].base_id + j,
+				       CurrentTime) == Success) {
+				port = adaptors[i].base_id + j;
+				printf("Using port %ld of adaptor '%s'\n",
+				       (long)port, adaptors[i].name);
+				break;
+			}
+		}
+	}
+
+	XvFreeAdaptorInfo(adaptors);
+	return port;
+}
+
+static void fill_frame(XvImage *image, int frame)
+{
+	int i;
+
+	/* Change every byte so that no frame can be skipped */
+	for (i = 0; i < image->data_size; i++)
+		image->data[i] = (i + frame) & 0xff;
+}
+
+static void run(Display *dpy, Window win, GC gc, XvPortID port,
+		int id, const char *name, int width, int height)
+{
+	XShmSegmentInfo shm;
+	XvImage *image;
+	struct timespec start, end, t0, t1;
+	double latency, max_latency;
+	int n;
+
+	image = XvShmCreateImage(dpy, port, id, NULL, width, height, &shm);
+	if (image == NULL)
+		return;
+
+	shm.shmid = shmget(IPC_PRIVATE, image->data_size, IPC_CREAT | 0600);
+	if (shm.shmid == -1) {
+		XFree(image);
+		return;
+	}
+
+	shm.shmaddr = image->data = shmat(shm.shmid, NULL, 0);
+	shm.readOnly = 1;
+	XShmAttach(dpy, &shm);
+	xsync(dpy, win);
+
+	/* Throughput: stream frames without waiting for each to complete */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < COUNT; n++) {
+		fill_frame(image, n);
+		XvShmPutImage(dpy, port, win, gc, image,
+			      0, 0, width, height,
+			      0, 0, width, height,
+			      False);
+		XFlush(dpy);
+	}
+	xsync(dpy, win);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("%d %s (%dx%d) frames in %fs: %.1f frames/s.\n",
+	       n, name, width, height, elapsed(&start, &end),
+	       n / elapsed(&start, &end));
+
+	/* Latency: wait for each frame to be presented before the next */
+	latency = max_latency = 0;
+	for (n = 0; n < COUNT; n++) {
+		double t;
+
+		fill_frame(image, n);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		XvShmPutImage(dpy, port, win, gc, image,
+			      0, 0, width, height,
+			      0, 0, width, height,
+			      False);
+		xsync(dpy, win);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		t = elapsed(&t0, &t1);
+		latency += t;
+		if (t > max_latency)
+			max_latency = t;
+	}
+	printf("%d %s (%dx%d) frames latency: average %.3fms, max %.3fms.\n",
+	       n, name, width, height,
+	       1e3 * latency / n, 1e3 * max_latency);
+
+	XShmDetach(dpy, &shm);
+	xsync(dpy, win);
+	shmdt(shm.shmaddr);
+	shmctl(shm.shmid, IPC_RMID, NULL);
+	XFree(image);
+}
+
+int main(void)
+{
+	static const struct {
+		int width, height;
+	} sizes[] = {
+		{ 640, 480 },
+		{ 1280, 720 },
+		{ 1920, 1080 },
+		{ 3840, 2160 },
+	};
+	XSetWindowAttributes attr;
+	Display *dpy;
+	XvPortID port;
+	Window win;
+	Atom vsync;
+	GC gc;
+	unsigned int i;
+
+	dpy = XOpenDisplay(NULL);
+	if (dpy == NULL)
+		return 77;
+
+	if (!XShmQueryExtension(dpy))
+		return 77;
+
+	port = find_port(dpy, FOURCC_I420);
+	if (port == 0)
+		return 77;
+
+	/* We want to measure the driver, not the refresh rate */
+	vsync = XInternAtom(dpy, "XV_SYNC_TO_VBLANK", True);
+	if (vsync != None)
+		XvSetPortAttribute(dpy, port, vsync, 0);
+
+	attr.override_redirect = 1;
+	win = XCreateWindow(dpy, DefaultRootWindow(dpy),
+			    0, 0,
+			    WidthOfScreen(DefaultScreenOfDisplay(dpy)),
+			    HeightOfScreen(DefaultScreenOfDisplay(dpy)),
+			    0, DefaultDepth(dpy, DefaultScreen(dpy)),
+			    InputOutput,
+			    DefaultVisual(dpy, DefaultScreen(dpy)),
+			    CWOverrideRedirect, &attr);
+	XMapWindow(dpy, win);
+	gc = XCreateGC(dpy, win, 0, NULL);
+	xsync(dpy, win);
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		run(dpy, win, gc, port, FOURCC_I420, "I420",
+		    sizes[i].width, sizes[i].height);
+		run(dpy, win, gc, port, FOURCC_YUY2, "YUY2",
+		    sizes[i].width, sizes[i].height);
+	}
+
+	XvUngrabPort(dpy, port, CurrentTime);
+	XFreeGC(dpy, gc);
+	XDestroyWindow(dpy, win);
+	XCloseDisplay(dpy);
+
+	return 0;
+}
@@ -38,6 +38,33 @@
 #include "uxa.h"
 #include "mipict.h"
 
+/* Number of clipped boxes gathered on the stack before handing them to
+ * the driver in one solid_boxes() call.
+ */
+#define UXA_SOLID_BOXES 256
+
+/* Beyond this many boxes, filling a region through the composite hooks
+ * as a single list of rectangles is cheaper than a blit per box.
+ */
+#define UXA_COMPOSITE_FILL_BOXES 256
+
+static void
+uxa_solid_boxes(uxa_screen_t *uxa_screen, PixmapPtr pixmap,
+		const BoxRec *box, int nbox)
+{
+	if (uxa_screen->info->solid_boxes) {
+		uxa_screen->info->solid_boxes(pixmap, box, nbox);
+		return;
+	}
+
+	while (nbox--) {
+		uxa_screen->info->solid(pixmap,
+					box->x1, box->y1,
+					box->x2, box->y2);
+		box++;
+	}
+}
+
 static void
 uxa_fill_spans(DrawablePtr pDrawable, GCPtr pGC, int n,
 	       DDXPointPtr ppt, int *pwidth, int fSorted)
@@ -46,8 +73,9 @@ uxa_fill_spans(DrawablePtr pDrawable, GCPtr pGC, int n,
 	uxa_screen_t *uxa_screen = uxa_get_screen(screen);
 	RegionPtr pClip = fbGetCompositeClip(pGC);
 	PixmapPtr dst_pixmap;
+	BoxRec boxes[UXA_SOLID_BOXES];
 	BoxPtr pbox;
-	int nbox;
+	int nbox, n_boxes = 0;
 	int x1, x2, y;
 	int off_x, off_y;
 
@@ -103,13 +131,23 @@ uxa_fill_spans(DrawablePtr pDrawable, GCPtr pGC, int n,
 			if (X2 > pbox->x2)
 				X2 = pbox->x2;
 
-			if (X2 > X1 && pbox->y1 <= y && pbox->y2 > y)
-				(*uxa_screen->info->solid) (dst_pixmap,
-							    X1 + off_x, y + off_y,
-							    X2 + off_x, y + 1 + off_y);
+			if (X2 > X1 && pbox->y1 <= y && pbox->y2 > y) {
+				if (n_boxes == UXA_SOLID_BOXES) {
+					uxa_solid_boxes(uxa_screen, dst_pixmap,
+							boxes, n_boxes);
+					n_boxes = 0;
+				}
+				boxes[n_boxes].x1 = X1 + off_x;
+				boxes[n_boxes].y1 = y + off_y;
+				boxes[n_boxes].x2 = X2 + off_x;
+				boxes[n_boxes].y2 = y + 1 + off_y;
+				n_boxes++;
+			}
 			pbox++;
 		}
 	}
+	if (n_boxes)
+		uxa_solid_boxes(uxa_screen, dst_pixmap, boxes, n_boxes);
 	(*uxa_screen->info->done_solid) (dst_pixmap);
 
 	return;
@@ -757,11 +795,12 @@ uxa_poly_fill_rect(DrawablePtr pDrawable,
 	RegionPtr pClip = fbGetCompositeClip(pGC);
 	PixmapPtr pPixmap;
 	RegionPtr pReg;
+	BoxRec boxes[UXA_SOLID_BOXES];
 	BoxPtr pbox;
 	int fullX1, fullX2, fullY1, fullY2;
 	int xoff, yoff;
 	int xorg, yorg;
-	int n;
+	int n, n_boxes = 0;
 
 	if (uxa_screen->info->flags & UXA_USE_GLAMOR) {
 		int ok = 0;
@@ -867,13 +906,20 @@ fallback:
 			if (x1 >= x2 || y1 >= y2)
 				continue;
 
-			(*uxa_screen->info->solid) (pPixmap,
-						    x1 + xoff,
-						    y1 + yoff,
-						    x2 + xoff,
-						    y2 + yoff);
+			if (n_boxes == UXA_SOLID_BOXES) {
+				uxa_solid_boxes(uxa_screen, pPixmap,
+						boxes, n_boxes);
+				n_boxes = 0;
+			}
+			boxes[n_boxes].x1 = x1 + xoff;
+			boxes[n_boxes].y1 = y1 + yoff;
+			boxes[n_boxes].x2 = x2 + xoff;
+			boxes[n_boxes].y2 = y2 + yoff;
+			n_boxes++;
 		}
 	}
+	if (n_boxes)
+		uxa_solid_boxes(uxa_screen, pPixmap, boxes, n_boxes);
 	(*uxa_screen->info->done_solid) (pPixmap);
 
 out:
@@ -1109,6 +1155,13 @@ uxa_fill_region_solid(DrawablePtr pDrawable,
 	nbox = REGION_NUM_RECTS(pRegion);
 	pBox = REGION_RECTS(pRegion);
 
+	if (nbox >= UXA_COMPOSITE_FILL_BOXES &&
+	    alu == GXcopy && UXA_PM_IS_SOLID(&pixmap->drawable, planemask) &&
+	    uxa_fill_region_composite(pixmap, pRegion, pixel)) {
+		ret = TRUE;
+		goto err;
+	}
+
 	if (uxa_screen->info->check_solid &&
 	    !uxa_screen->info->check_solid(&pixmap->drawable, alu, planemask))
 		goto err;
@@ -1116,12 +1169,7 @@ uxa_fill_region_solid(DrawablePtr pDrawable,
 	if (!uxa_screen->info->prepare_solid(pixmap, alu, planemask, pixel))
 		goto err;
 
-	while (nbox--) {
-		uxa_screen->info->solid(pixmap,
-					pBox->x1, pBox->y1,
-					pBox->x2, pBox->y2);
-		pBox++;
-	}
+	uxa_solid_boxes(uxa_screen, pixmap, pBox, nbox);
 	uxa_screen->info->done_solid(pixmap);
 	ret = TRUE;
 
@@ -129,6 +129,13 @@ static void uxa_unrealize_glyph_caches(ScreenPtr pScreen)
 
 void uxa_glyphs_fini(ScreenPtr pScreen)
 {
+	uxa_screen_t *uxa_screen = uxa_get_screen(pScreen);
+
+	if (uxa_screen->fallback_debug && uxa_screen->glyph_count)
+		ErrorF("UXA glyphs: %lu composited with %lu setups (%.2f setups/glyph)\n",
+		       uxa_screen->glyph_count, uxa_screen->glyph_setups,
+		       (double)uxa_screen->glyph_setups / uxa_screen->glyph_count);
+
 	uxa_unrealize_glyph_caches(pScreen);
 }
 
@@ -734,6 +741,87 @@ create_white_solid(ScreenPtr screen)
 	return ret;
 }
 
+/* Where to find the glyph for compositing: its slot in the cache,
+ * uploading it if necessary, or its own picture if it is too large to
+ * be cached.
+ */
+static PicturePtr
+uxa_glyph_atlas(ScreenPtr screen, GlyphPtr glyph,
+		INT16 *out_x, INT16 *out_y, Bool *cached)
+{
+	struct uxa_glyph *priv;
+	PicturePtr atlas;
+	int x, y;
+
+	priv = uxa_glyph_get_private(glyph);
+	if (priv != NULL) {
+		*out_x = priv->x;
+		*out_y = priv->y;
+		*cached = TRUE;
+		return priv->cache->picture;
+	}
+
+	atlas = uxa_glyph_cache(screen, glyph, &x, &y);
+	if (atlas == NULL) {
+		/* no cache for this glyph */
+		*out_x = *out_y = 0;
+		*cached = FALSE;
+		return GetGlyphPicture(glyph, screen);
+	}
+
+	*out_x = x;
+	*out_y = y;
+	*cached = TRUE;
+	return atlas;
+}
+
+struct uxa_glyph_draw {
+	PicturePtr atlas;
+	GlyphPtr glyph;
+	INT16 src_x, src_y;
+	INT16 dst_x, dst_y;
+	Bool cached;
+};
+
+static int
+uxa_glyph_draw_cmp(const void *A, const void *B)
+{
+	const struct uxa_glyph_draw *a = A, *b = B;
+
+	if (a->atlas == b->atlas)
+		return 0;
+
+	/* Evicted glyphs are redrawn last, as reloading them may in
+	 * turn evict another glyph that is still waiting to be drawn.
+	 */
+	if (a->atlas == NULL)
+		return 1;
+	if (b->atlas == NULL)
+		return -1;
+
+	return (uintptr_t)a->atlas < (uintptr_t)b->atlas ? -1 : 1;
+}
+
+static Bool
+uxa_glyphs_prepare(uxa_screen_t *uxa_screen,
+		   PicturePtr white, PixmapPtr white_pixmap,
+		   PicturePtr atlas, PicturePtr mask, PixmapPtr pixmap)
+{
+	PixmapPtr glyph_pixmap;
+
+	glyph_pixmap = uxa_get_drawable_pixmap(atlas->pDrawable);
+	if (!uxa_pixmap_is_offscreen(glyph_pixmap))
+		return FALSE;
+
+	if (!uxa_screen->info->prepare_composite(PictOpAdd,
+						 white, atlas, mask,
+						 white_pixmap, glyph_pixmap, pixmap))
+		return FALSE;
+
+	uxa_screen->glyph_setups++;
+	return TRUE;
+}
+
 static int
 uxa_glyphs_via_mask(CARD8 op,
 		    PicturePtr pSrc,
@@ -747,10 +835,11 @@ uxa_glyphs_via_mask(CARD8 op,
 	CARD32 component_alpha;
 	PixmapPtr pixmap, white_pixmap;
 	PicturePtr glyph_atlas, mask, white;
+	struct uxa_glyph_draw stack_draw[256], *draw;
 	int xDst = list->xOff, yDst = list->yOff;
 	int x, y, width, height;
 	int dst_off_x, dst_off_y;
-	int n, error;
+	int n, count, error;
 	BoxRec box;
 
 	uxa_glyph_extents(nlist, list, glyphs, &box);
@@ -812,65 +901,43 @@ uxa_glyphs_via_mask(CARD8 op,
 
 	ValidatePicture(mask);
 
-	glyph_atlas = NULL;
+	count = 0;
+	for (n = 0; n < nlist; n++)
+		count += list[n].len;
+
+	draw = stack_draw;
+	if (count > (int)(sizeof(stack_draw) / sizeof(stack_draw[0]))) {
+		draw = malloc(sizeof(*draw) * count);
+		if (draw == NULL) {
+			FreePicture(white, 0);
+			FreePicture(mask, 0);
+			return -1;
+		}
+	}
+
+	/* First make every glyph resident, so that uploading into the
+	 * caches does not interrupt the composite, and record where each
+	 * one is to be drawn.
+	 */
+	count = 0;
 	while (nlist--) {
 		x += list->xOff;
 		y += list->yOff;
 		n = list->len;
 		while (n--) {
 			GlyphPtr glyph = *glyphs++;
-			PicturePtr this_atlas;
-			int glyph_x, glyph_y;
-			struct uxa_glyph *priv;
+			struct uxa_glyph_draw *d;
 
 			if (glyph->info.width == 0 || glyph->info.height == 0)
 				goto next_glyph;
 
-			priv = uxa_glyph_get_private(glyph);
-			if (priv != NULL) {
-				glyph_x = priv->x;
-				glyph_y = priv->y;
-				this_atlas = priv->cache->picture;
-			} else {
-				if (glyph_atlas) {
-					uxa_screen->info->done_composite(pixmap);
-					glyph_atlas = NULL;
-				}
-				this_atlas = uxa_glyph_cache(screen, glyph, &glyph_x, &glyph_y);
-				if (this_atlas == NULL) {
-					/* no cache for this glyph */
-					this_atlas = GetGlyphPicture(glyph, screen);
-					glyph_x = glyph_y = 0;
-				}
-			}
-
-			if (this_atlas != glyph_atlas) {
-				PixmapPtr glyph_pixmap;
-
-				if (glyph_atlas)
-					uxa_screen->info->done_composite(pixmap);
-
-				glyph_pixmap =
-					uxa_get_drawable_pixmap(this_atlas->pDrawable);
-				if (!uxa_pixmap_is_offscreen(glyph_pixmap) ||
-				    !uxa_screen->info->prepare_composite(PictOpAdd,
-									 white, this_atlas, mask,
-									 white_pixmap, glyph_pixmap, pixmap)) {
-					FreePicture(white, 0);
-					FreePicture(mask, 0);
-					return -1;
-				}
-
-				glyph_atlas = this_atlas;
-			}
-
-			uxa_screen->info->composite(pixmap,
-						    0, 0,
-						    glyph_x, glyph_y,
-						    x - glyph->info.x,
-						    y - glyph->info.y,
-						    glyph->info.width,
-						    glyph->info.height);
+			d = &draw[count++];
+			d->glyph = glyph;
+			d->atlas = uxa_glyph_atlas(screen, glyph,
+						   &d->src_x, &d->src_y,
+						   &d->cached);
+			d->dst_x = x - glyph->info.x;
+			d->dst_y = y - glyph->info.y;
 
 next_glyph:
 			x += glyph->info.xOff;
@@ -878,9 +945,77 @@ next_glyph:
 		}
 		list++;
 	}
+
+	/* Filling one cache may have evicted an earlier glyph of this
+	 * same string; those are reloaded and drawn one at a time at the
+	 * end.
+	 */
+	for (n = 0; n < count; n++) {
+		struct uxa_glyph_draw *d = &draw[n];
+		struct uxa_glyph *priv;
+
+		if (!d->cached)
+			continue;
+
+		priv = uxa_glyph_get_private(d->glyph);
+		if (priv == NULL ||
+		    priv->cache->picture != d->atlas ||
+		    priv->x != d->src_x || priv->y != d->src_y)
+			d->atlas = NULL;
+	}
+
+	/* Adding into the mask is commutative, so we are free to emit the
+	 * glyphs grouped by atlas and set up the composite just once for
+	 * each atlas.
+	 */
+	qsort(draw, count, sizeof(*draw), uxa_glyph_draw_cmp);
+
+	glyph_atlas = NULL;
+	for (n = 0; n < count; n++) {
+		struct uxa_glyph_draw *d = &draw[n];
+
+		if (d->atlas == NULL) {
+			if (glyph_atlas) {
+				uxa_screen->info->done_composite(pixmap);
+				glyph_atlas = NULL;
+			}
+
+			d->atlas = uxa_glyph_atlas(screen, d->glyph,
+						   &d->src_x, &d->src_y,
+						   &d->cached);
+		}
+
+		if (d->atlas != glyph_atlas) {
+			if (glyph_atlas)
+				uxa_screen->info->done_composite(pixmap);
+
+			if (!uxa_glyphs_prepare(uxa_screen, white, white_pixmap,
+						d->atlas, mask, pixmap)) {
+				if (draw != stack_draw)
+					free(draw);
+				FreePicture(white, 0);
+				FreePicture(mask, 0);
+				return -1;
+			}
+
+			glyph_atlas = d->atlas;
+		}
+
+		uxa_screen->info->composite(pixmap,
+					    0, 0,
+					    d->src_x, d->src_y,
+					    d->dst_x, d->dst_y,
+					    d->glyph->info.width,
+					    d->glyph->info.height);
+	}
 	if (glyph_atlas)
 		uxa_screen->info->done_composite(pixmap);
 
+	uxa_screen->glyph_count += count;
+
+	if (draw != stack_draw)
+		free(draw);
+
 	uxa_composite(op,
 		      pSrc, mask, pDst,
 		      dst_off_x + xSrc - xDst,
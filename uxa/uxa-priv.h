@@ -136,6 +136,7 @@ typedef struct {
 
 	uxa_glyph_cache_t glyphCaches[UXA_NUM_GLYPH_CACHE_FORMATS];
 	Bool glyph_cache_initialized;
+	unsigned long glyph_count, glyph_setups;
 
 	PicturePtr solid_clear, solid_black, solid_white;
 	uxa_solid_cache_t solid_cache[UXA_NUM_SOLID_CACHE];
@@ -412,6 +413,9 @@ uxa_acquire_pattern(ScreenPtr pScreen,
 		    INT16 x, INT16 y,
 		    CARD16 width, CARD16 height);
 
+Bool
+uxa_fill_region_composite(PixmapPtr pixmap, RegionPtr region, Pixel pixel);
+
 Bool
 uxa_get_rgba_from_pixel(CARD32 pixel,
 			CARD16 * red,
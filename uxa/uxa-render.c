@@ -947,15 +947,22 @@ uxa_acquire_mask(ScreenPtr screen,
 				    out_x, out_y);
 }
 
+/**
+ * uxa_try_driver_composite_boxes performs the composite through the
+ * driver's prepare_composite/composite hooks. If @boxes is given, the
+ * operation is further restricted to those boxes (in screen coordinates),
+ * all of which are emitted following a single prepare_composite.
+ */
 static int
-uxa_try_driver_composite(CARD8 op,
-			 PicturePtr pSrc,
-			 PicturePtr pMask,
-			 PicturePtr pDst,
-			 INT16 xSrc, INT16 ySrc,
-			 INT16 xMask, INT16 yMask,
-			 INT16 xDst, INT16 yDst,
-			 CARD16 width, CARD16 height)
+uxa_try_driver_composite_boxes(CARD8 op,
+			       PicturePtr pSrc,
+			       PicturePtr pMask,
+			       PicturePtr pDst,
+			       INT16 xSrc, INT16 ySrc,
+			       INT16 xMask, INT16 yMask,
+			       INT16 xDst, INT16 yDst,
+			       CARD16 width, CARD16 height,
+			       RegionPtr boxes)
 {
 	ScreenPtr screen = pDst->pDrawable->pScreen;
 	uxa_screen_t *uxa_screen = uxa_get_screen(screen);
@@ -980,6 +987,9 @@ uxa_try_driver_composite(CARD8 op,
 		GCPtr gc;
 
 		pixmap = uxa_get_drawable_pixmap(pDst->pDrawable);
+		if (boxes)
+			return -1;
+
 		if (uxa_screen->info->check_copy &&
 		    !uxa_screen->info->check_copy(pixmap, pixmap, GXcopy, FB_ALLONES))
 			return -1;
@@ -1064,6 +1074,26 @@ uxa_try_driver_composite(CARD8 op,
 		return 1;
 	}
 
+	if (boxes) {
+		int ret = -1;
+
+		if (!REGION_INTERSECT(screen, &region, &region, boxes))
+			ret = 0;
+		else if (!REGION_NOTEMPTY(screen, &region))
+			ret = 1;
+
+		if (ret != -1) {
+			REGION_UNINIT(screen, &region);
+
+			if (localSrc != pSrc)
+				FreePicture(localSrc, 0);
+			if (localMask && localMask != pMask)
+				FreePicture(localMask, 0);
+
+			return ret;
+		}
+	}
+
 	pSrcPix = uxa_get_offscreen_pixmap(localSrc->pDrawable,
 					   &src_off_x, &src_off_y);
 	if (!pSrcPix) {
@@ -1158,6 +1188,96 @@ uxa_try_driver_composite(CARD8 op,
 	return 1;
 }
 
+static int
+uxa_try_driver_composite(CARD8 op,
+			 PicturePtr pSrc,
+			 PicturePtr pMask,
+			 PicturePtr pDst,
+			 INT16 xSrc, INT16 ySrc,
+			 INT16 xMask, INT16 yMask,
+			 INT16 xDst, INT16 yDst,
+			 CARD16 width, CARD16 height)
+{
+	return uxa_try_driver_composite_boxes(op, pSrc, pMask, pDst,
+					      xSrc, ySrc,
+					      xMask, yMask,
+					      xDst, yDst,
+					      width, height,
+					      NULL);
+}
+
+/**
+ * uxa_fill_region_composite fills @region (in pixmap coordinates) of
+ * @pixmap with @pixel as a PictOpSrc composite, so that all the boxes
+ * are emitted as a single list of rectangles following one
+ * prepare_composite. The caller is responsible for only using this for
+ * GXcopy with a solid planemask.
+ */
+Bool
+uxa_fill_region_composite(PixmapPtr pixmap, RegionPtr region, Pixel pixel)
+{
+	ScreenPtr screen = pixmap->drawable.pScreen;
+	PictFormatPtr format;
+	PicturePtr src, dst;
+	xRenderColor color;
+	BoxPtr extents;
+	int error, ret;
+
+	switch (pixmap->drawable.depth) {
+	case 32:
+		/* Only opaque (or clear) pixels survive premultiplication */
+		if ((pixel >> 24) != 0xff && pixel != 0)
+			return FALSE;
+		format = PictureMatchFormat(screen, 32, PICT_a8r8g8b8);
+		break;
+	case 24:
+		format = PictureMatchFormat(screen, 24, PICT_x8r8g8b8);
+		break;
+	case 16:
+		format = PictureMatchFormat(screen, 16, PICT_r5g6b5);
+		break;
+	case 8:
+		format = PictureMatchFormat(screen, 8, PICT_a8);
+		break;
+	default:
+		return FALSE;
+	}
+	if (!format)
+		return FALSE;
+
+	if (!uxa_get_rgba_from_pixel(pixel,
+				     &color.red, &color.green,
+				     &color.blue, &color.alpha,
+				     format->format))
+		return FALSE;
+
+	src = CreateSolidPicture(0, &color, &error);
+	if (!src)
+		return FALSE;
+
+	dst = CreatePicture(0, &pixmap->drawable, format,
+			    0, 0, serverClient, &error);
+	if (!dst) {
+		FreePicture(src, 0);
+		return FALSE;
+	}
+	ValidatePicture(dst);
+
+	extents = REGION_EXTENTS(screen, region);
+	ret = uxa_try_driver_composite_boxes(PictOpSrc, src, NULL, dst,
+					     0, 0,
+					     0, 0,
+					     extents->x1, extents->y1,
+					     extents->x2 - extents->x1,
+					     extents->y2 - extents->y1,
+					     region);
+
+	FreePicture(dst, 0);
+	FreePicture(src, 0);
+
+	return ret == 1;
+}
+
 /**
  * uxa_try_magic_two_pass_composite_helper implements PictOpOver using two passes of
  * simpler operations PictOpOutReverse and PictOpAdd. Mainly used for component
@@ -1700,6 +1820,113 @@ uxa_check_trapezoids(CARD8 op, PicturePtr src, PicturePtr dst,
 	}
 }
 
+static Bool
+uxa_trapezoid_is_aligned(const xTrapezoid *t)
+{
+	return t->left.p1.x == t->left.p2.x &&
+		t->right.p1.x == t->right.p2.x &&
+		pixman_fixed_frac(t->top | t->bottom |
+				  t->left.p1.x | t->right.p1.x) == 0;
+}
+
+static Bool
+uxa_operator_is_bounded(CARD8 op)
+{
+	switch (op) {
+	case PictOpOver:
+	case PictOpOutReverse:
+	case PictOpAdd:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * uxa_trapezoids_aligned handles the common case of trapezoids that are
+ * just pixel-aligned rectangles, as generated for the fills and strokes
+ * of rectilinear paths. Every pixel is either fully covered or not at
+ * all, so instead of rasterizing a mask on the CPU and uploading it, we
+ * convert each trapezoid into a box and composite the source through
+ * their union directly. As the mask would have been zero outside of the
+ * boxes, this is only valid for operators that leave the destination
+ * untouched where the source is transparent.
+ */
+static Bool
+uxa_trapezoids_aligned(CARD8 op, PicturePtr src, PicturePtr dst,
+		       INT16 xSrc, INT16 ySrc,
+		       int ntrap, xTrapezoid * traps,
+		       const BoxRec *bounds)
+{
+	ScreenPtr screen = dst->pDrawable->pScreen;
+	BoxRec stack_boxes[64], *boxes;
+	RegionRec region;
+	INT16 xDst, yDst;
+	int i, n, ret;
+
+	if (!uxa_operator_is_bounded(op))
+		return FALSE;
+
+	if (dst->alphaMap || src->alphaMap)
+		return FALSE;
+
+	for (i = 0; i < ntrap; i++)
+		if (!uxa_trapezoid_is_aligned(&traps[i]))
+			return FALSE;
+
+	boxes = stack_boxes;
+	if (ntrap > (int)(sizeof(stack_boxes) / sizeof(stack_boxes[0]))) {
+		boxes = malloc(sizeof(BoxRec) * ntrap);
+		if (boxes == NULL)
+			return FALSE;
+	}
+
+	for (i = n = 0; i < ntrap; i++) {
+		BoxRec *b = &boxes[n];
+
+		b->x1 = pixman_fixed_to_int(traps[i].left.p1.x);
+		b->x2 = pixman_fixed_to_int(traps[i].right.p1.x);
+		b->y1 = pixman_fixed_to_int(traps[i].top);
+		b->y2 = pixman_fixed_to_int(traps[i].bottom);
+		if (b->x1 >= b->x2 || b->y1 >= b->y2)
+			continue;
+
+		b->x1 += dst->pDrawable->x;
+		b->x2 += dst->pDrawable->x;
+		b->y1 += dst->pDrawable->y;
+		b->y2 += dst->pDrawable->y;
+		n++;
+	}
+
+	ret = 1;
+	if (n) {
+		/* The mask saturates, so overlapping boxes count only once */
+		if (!pixman_region_init_rects(&region, boxes, n)) {
+			if (boxes != stack_boxes)
+				free(boxes);
+			return FALSE;
+		}
+
+		xDst = traps[0].left.p1.x >> 16;
+		yDst = traps[0].left.p1.y >> 16;
+
+		ret = uxa_try_driver_composite_boxes(op, src, NULL, dst,
+						     bounds->x1 + xSrc - xDst,
+						     bounds->y1 + ySrc - yDst,
+						     0, 0,
+						     bounds->x1, bounds->y1,
+						     bounds->x2 - bounds->x1,
+						     bounds->y2 - bounds->y1,
+						     &region);
+		REGION_UNINIT(screen, &region);
+	}
+
+	if (boxes != stack_boxes)
+		free(boxes);
+
+	return ret == 1;
+}
+
 /**
  * uxa_trapezoids is essentially a copy of miTrapezoids that uses
  * uxa_create_alpha_picture instead of miCreateAlphaPicture.
@@ -1774,6 +2001,11 @@ fallback:
 				(*ps->RasterizeTrapezoid) (dst, traps, 0, 0);
 			uxa_finish_access(pDraw, UXA_ACCESS_RW);
 		}
+	} else if (maskFormat &&
+		   uxa_screen->info->prepare_composite &&
+		   uxa_trapezoids_aligned(op, src, dst, xSrc, ySrc,
+					  ntrap, traps, &bounds)) {
+		return;
 	} else if (maskFormat) {
 		PixmapPtr scratch = NULL;
 		PicturePtr mask;
@@ -132,6 +132,23 @@ typedef struct _UxaDriver {
 	 */
 	void (*solid) (PixmapPtr pPixmap, int x1, int y1, int x2, int y2);
 
+	/**
+	 * solid_boxes() performs the solid fill set up in the last
+	 * prepare_solid() call over a list of boxes.
+	 *
+	 * @param pPixmap destination pixmap
+	 * @param box array of boxes to fill
+	 * @param nbox number of boxes in the array
+	 *
+	 * Equivalent to calling solid() once for each box, in destination
+	 * pixmap coordinates, but lets the driver amortize its per-call
+	 * setup and command emission across all of them.
+	 *
+	 * This call is optional; if it is NULL, UXA calls solid() for each
+	 * box instead.
+	 */
+	void (*solid_boxes) (PixmapPtr pPixmap, const BoxRec *box, int nbox);
+
 	/**
 	 * done_solid() finishes a set of solid fills.
 	 *